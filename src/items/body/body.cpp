@@ -0,0 +1,227 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "body.h"
+
+#include <algorithm>
+
+#include "items/hands/hand_joints.h"
+#include "util/util_file.h"
+#include "xr/xrp.h"
+
+static constexpr char body_stream_magic[4] = {'C', 'P', 'T', 'B'};
+static constexpr uint32_t body_stream_version = 1;
+
+// e.g. "left_hand_index_proximal"
+static std::string GetBodyJointName(size_t joint) {
+	static const char* const body_names[] = {
+		"root",
+		"hips",
+		"spine_lower",
+		"spine_middle",
+		"spine_upper",
+		"chest",
+		"neck",
+		"head",
+		"left_shoulder",
+		"left_scapula",
+		"left_arm_upper",
+		"left_arm_lower",
+		"left_hand_wrist_twist",
+		"right_shoulder",
+		"right_scapula",
+		"right_arm_upper",
+		"right_arm_lower",
+		"right_hand_wrist_twist",
+	};
+	static constexpr size_t body_name_count = sizeof(body_names) / sizeof(body_names[0]);
+
+	// followed by the joints of each hand, in the same order as XR_EXT_hand_tracking
+	if (joint < body_name_count) {
+		return body_names[joint];
+	} else if (joint < body_name_count + hand_joint_count) {
+		return std::string("left_hand_") + GetHandJointName(joint - body_name_count);
+	}
+
+	return std::string("right_hand_") + GetHandJointName(joint - body_name_count - hand_joint_count);
+}
+
+BodyItemSet::BodyItemSet(pugi::xml_node body_config) {
+	config_ = body_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+}
+
+bool BodyItemSet::GetRequiredExtensions(std::set<std::string>& out_extensions) {
+	out_extensions.emplace(XR_FB_BODY_TRACKING_EXTENSION_NAME);
+
+	return true;
+}
+
+bool BodyItemSet::IsSupported(const XrpContext& context) {
+	if (!XrpIsExtensionAvailable(context, XR_FB_BODY_TRACKING_EXTENSION_NAME) || !context.dispatch.xrCreateBodyTrackerFB) {
+		XrpLog("Body tracking requires %s, which is not available", XR_FB_BODY_TRACKING_EXTENSION_NAME);
+		return false;
+	}
+
+	return true;
+}
+
+bool BodyItemSet::Init(XrpContext& context) {
+	destroy_body_tracker_ = context.dispatch.xrDestroyBodyTrackerFB;
+
+	XrBodyTrackerCreateInfoFB body_tracker_create_info = {
+		.type = XR_TYPE_BODY_TRACKER_CREATE_INFO_FB,
+		.next = nullptr,
+		.bodyJointSet = XR_BODY_JOINT_SET_DEFAULT_FB,
+	};
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrCreateBodyTrackerFB(context.session, &body_tracker_create_info, &body_tracker_));
+
+	frames_.resize(std::max(config_.attribute("ring_frames").as_uint(256), 1u));
+
+	const std::string stream_file = config_.attribute("stream_file").value();
+	if (!stream_file.empty()) {
+		const std::string stream_file_path = GetOutputDirectory() + stream_file;
+
+		stream_file_ = fopen(stream_file_path.c_str(), "wb");
+		if (!stream_file_) {
+			XrpLog("Failed to open body stream file: %s", stream_file_path.c_str());
+		} else {
+			const uint32_t joint_count = body_joint_count;
+			const uint32_t frame_size = sizeof(BodyFrame);
+			fwrite(body_stream_magic, sizeof(body_stream_magic), 1, stream_file_);
+			fwrite(&body_stream_version, sizeof(body_stream_version), 1, stream_file_);
+			fwrite(&joint_count, sizeof(joint_count), 1, stream_file_);
+			fwrite(&frame_size, sizeof(frame_size), 1, stream_file_);
+		}
+	}
+
+	return true;
+}
+
+void BodyItemSet::FlushFrames() {
+	if (stream_file_ && frame_index_ > 0 && fwrite(frames_.data(), sizeof(BodyFrame), frame_index_, stream_file_) != frame_index_) {
+		XrpLog("Failed to write body stream file");
+	}
+
+	frame_index_ = 0;
+}
+
+bool BodyItemSet::Sample(const XrpContext& context, bool& out_complete) {
+	out_complete = sampled_frames_ >= sample_count_;
+	if (out_complete) {
+		return true;
+	}
+
+	if (!context.dispatch.xrLocateBodyJointsFB || body_tracker_ == XR_NULL_HANDLE) {
+		XrpLog("Body tracking was not initialized");
+		return false;
+	}
+
+	XrBodyJointsLocateInfoFB locate_info = {
+		.type = XR_TYPE_BODY_JOINTS_LOCATE_INFO_FB,
+		.next = nullptr,
+		.baseSpace = context.reference_space,
+		.time = context.current_frame_state.predictedDisplayTime,
+	};
+	XrBodyJointLocationsFB joint_locations = {
+		.type = XR_TYPE_BODY_JOINT_LOCATIONS_FB,
+		.next = nullptr,
+		.jointCount = static_cast<uint32_t>(joint_locations_.size()),
+		.jointLocations = joint_locations_.data(),
+	};
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrLocateBodyJointsFB(body_tracker_, &locate_info, &joint_locations));
+
+	if (!joint_locations.isActive) {
+		XrpLog("Body is not being tracked.");
+		rejected_frames_++;
+		return true;
+	}
+
+	BodyFrame& frame = frames_[frame_index_];
+	frame.time = joint_locations.time;
+	frame.confidence = joint_locations.confidence;
+	frame.skeleton_changed_count = joint_locations.skeletonChangedCount;
+
+	const XrSpaceLocationFlags required_flags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT;
+	XrSpaceLocationFlags valid_flags = required_flags;
+	for (size_t i = 0; i < body_joint_count; i++) {
+		frame.location_flags[i] = joint_locations_[i].locationFlags;
+		valid_flags &= joint_locations_[i].locationFlags;
+	}
+
+	frame.poses.Load(joint_locations_.data());
+
+	// only frames where every joint was located are accumulated, so every joint has the same number of samples
+	if (valid_flags == required_flags) {
+		statistics_.Add(frame.poses);
+		confidence_.Add(frame.confidence);
+		sampled_frames_++;
+	} else {
+		rejected_frames_++;
+	}
+
+	if (++frame_index_ == frames_.size()) {
+		FlushFrames();
+	}
+
+	out_complete = sampled_frames_ >= sample_count_;
+
+	return true;
+}
+
+bool BodyItemSet::GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) {
+	FlushFrames();
+	if (stream_file_) {
+		fflush(stream_file_);
+	}
+
+	if (statistics_.count == 0) {
+		XrpLog("No samples were taken for the body.");
+		return false;
+	}
+
+	ItemFile item_file = {
+		.name = "body",
+	};
+
+	pugi::xml_node body_node = item_file.document.append_child("body");
+	if (statistics_.count > 1) {
+		body_node.append_attribute("samples") = statistics_.count;
+	}
+	if (rejected_frames_ > 0) {
+		body_node.append_attribute("rejected_frames") = rejected_frames_;
+	}
+
+	{
+		pugi::xml_node confidence_node = body_node.append_child("confidence");
+		MakeNode(confidence_node, "mean", static_cast<float>(confidence_.mean), 3);
+		MakeNode(confidence_node, "min", static_cast<float>(confidence_.min), 3);
+		MakeNode(confidence_node, "max", static_cast<float>(confidence_.max), 3);
+	}
+
+	for (size_t i = 0; i < body_joint_count; i++) {
+		pugi::xml_node joint_node = body_node.append_child("joint");
+		joint_node.append_attribute("name") = GetBodyJointName(i).c_str();
+
+		MakePoseNodes(joint_node, statistics_.GetMeanPose(i), statistics_.count, statistics_.GetPositionStandardDeviation(i),
+					  statistics_.GetOrientationStandardDeviation(i));
+	}
+
+	out_itemset.output_files.emplace_back(std::move(item_file));
+
+	return true;
+}
+
+BodyItemSet::~BodyItemSet() {
+	if (stream_file_) {
+		FlushFrames();
+		fclose(stream_file_);
+	}
+
+	if (body_tracker_ != XR_NULL_HANDLE && destroy_body_tracker_) {
+		destroy_body_tracker_(body_tracker_);
+	}
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "items/item.h"
+#include "pugixml.hpp"
+#include "util/util_joint_statistics.h"
+#include "util/util_statistics.h"
+
+static constexpr size_t body_joint_count = XR_BODY_JOINT_COUNT_FB;
+
+// Every body joint located in one frame. Plain data without padding, so whole frames are written to the stream file as they are
+struct BodyFrame {
+	XrTime time;
+	float confidence;
+	uint32_t skeleton_changed_count;
+	XrSpaceLocationFlags location_flags[body_joint_count];
+	JointPoseFrame<body_joint_count> poses;
+};
+
+static_assert(sizeof(BodyFrame) == sizeof(XrTime) + sizeof(float) + sizeof(uint32_t) + sizeof(XrSpaceLocationFlags) * body_joint_count +
+									   sizeof(JointPoseFrame<body_joint_count>),
+			  "BodyFrame must not have padding");
+
+// Locates every body joint with XR_FB_body_tracking each frame. Sampling never allocates or formats strings: joints are located
+// into a ring buffer allocated up front, which is written to the optional stream file each time it fills up.
+//
+// The stream file starts with the magic "CPTB", a version, the joint count and the size of a frame, followed by every located
+// frame as a BodyFrame, in the byte order of the machine that wrote it.
+class BodyItemSet : public IItemSet {
+   public:
+	explicit BodyItemSet(pugi::xml_node body_config);
+
+	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
+	bool IsSupported(const XrpContext& context) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
+	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
+
+	~BodyItemSet() override;
+
+   private:
+	// writes the frames in the ring buffer that haven't been written yet
+	void FlushFrames();
+
+	pugi::xml_node config_;
+
+	XrBodyTrackerFB body_tracker_ = XR_NULL_HANDLE;
+	// destructors don't have the context
+	PFN_xrDestroyBodyTrackerFB destroy_body_tracker_ = nullptr;
+
+	// xrLocateBodyJointsFB writes here, before the joints are transposed into the ring buffer
+	std::array<XrBodyJointLocationFB, body_joint_count> joint_locations_;
+
+	std::vector<BodyFrame> frames_;
+	// next frame in the ring buffer to locate into. Every frame before it hasn't been written to the stream file yet
+	size_t frame_index_ = 0;
+
+	FILE* stream_file_ = nullptr;
+
+	JointPoseStatistics<body_joint_count> statistics_;
+	RunningStatistics confidence_;
+	// frames where the body wasn't tracked, or not every joint could be located
+	uint64_t rejected_frames_ = 0;
+
+	// number of frames to sample the joints over
+	uint32_t sample_count_ = 1;
+	uint32_t sampled_frames_ = 0;
+};
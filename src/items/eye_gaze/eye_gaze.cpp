@@ -0,0 +1,149 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "eye_gaze.h"
+
+#include <algorithm>
+
+#include "xr/xrp.h"
+
+EyeGazeItemSet::EyeGazeItemSet(pugi::xml_node eye_gaze_config) {
+	config_ = eye_gaze_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+	gaze_binding_ = std::string("/user/eyes_ext") + config_.attribute("binding").as_string("/input/gaze_ext/pose");
+}
+
+bool EyeGazeItemSet::GetRequiredExtensions(std::set<std::string>& out_extensions) {
+	out_extensions.emplace(XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME);
+
+	return true;
+}
+
+bool EyeGazeItemSet::IsSupported(const XrpContext& context) {
+	if (!XrpIsExtensionAvailable(context, XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME)) {
+		XrpLog("Eye gaze requires %s, which is not available", XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME);
+		return false;
+	}
+
+	return true;
+}
+
+bool EyeGazeItemSet::Init(XrpContext& context) {
+	samples_.resize(std::max(config_.attribute("ring_samples").as_uint(1024), 1u));
+
+	return true;
+}
+
+bool EyeGazeItemSet::Sample(const XrpContext& context, bool& out_complete) {
+	out_complete = located_frames_ >= sample_count_;
+	if (out_complete) {
+		return true;
+	}
+
+	// the inputs item set creates the action spaces once the session has been created
+	if (gaze_space_ == XR_NULL_HANDLE) {
+		const auto gaze_space_it = context.action_spaces.find(gaze_binding_);
+		if (gaze_space_it == context.action_spaces.end()) {
+			XrpLog("Eye gaze needs an input action of type \"eye_gaze\" bound to %s", gaze_binding_.c_str());
+			return false;
+		}
+
+		gaze_space_ = gaze_space_it->second;
+	}
+
+	XrEyeGazeSampleTimeEXT eye_gaze_sample_time = {
+		.type = XR_TYPE_EYE_GAZE_SAMPLE_TIME_EXT,
+		.next = nullptr,
+	};
+	XrSpaceLocation space_location = {
+		.type = XR_TYPE_SPACE_LOCATION,
+		.next = &eye_gaze_sample_time,
+	};
+	const XrTime display_time = context.current_frame_state.predictedDisplayTime;
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrLocateSpace(gaze_space_, context.reference_space, display_time, &space_location));
+
+	located_frames_++;
+	out_complete = located_frames_ >= sample_count_;
+
+	// the sample time is only filled in when the gaze is tracked
+	const XrSpaceLocationFlags required_flags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+	if ((space_location.locationFlags & required_flags) != required_flags || eye_gaze_sample_time.time == 0) {
+		invalid_frames_++;
+		return true;
+	}
+
+	// the runtime returns the latest gaze it has, which is the same for every frame until the eye tracker samples again. Only new
+	// samples are kept, as a repeated sample would count its age at a later display time as latency
+	if (new_samples_ > 0 && eye_gaze_sample_time.time == last_sample_time_) {
+		return true;
+	}
+
+	if (new_samples_ == 0) {
+		first_sample_time_ = eye_gaze_sample_time.time;
+	}
+	last_sample_time_ = eye_gaze_sample_time.time;
+	new_samples_++;
+
+	samples_[sample_index_] = {
+		.display_time = display_time,
+		.sample_time = eye_gaze_sample_time.time,
+		.location_flags = space_location.locationFlags,
+		.pose = space_location.pose,
+	};
+	sample_index_ = (sample_index_ + 1) % samples_.size();
+	ring_count_ = std::min(ring_count_ + 1, samples_.size());
+
+	latency_.Add(static_cast<double>(display_time - eye_gaze_sample_time.time) / 1e6);
+
+	return true;
+}
+
+bool EyeGazeItemSet::GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) {
+	if (ring_count_ == 0) {
+		XrpLog("No samples were taken for the eye gaze.");
+		return false;
+	}
+
+	ItemFile item_file = {
+		.name = "eye_gaze",
+	};
+
+	// the rate the eye tracker produced new samples at, rather than the rate they were located
+	const double sample_period_seconds = static_cast<double>(last_sample_time_ - first_sample_time_) / 1e9;
+	const double sample_rate = sample_period_seconds > 0.0 ? static_cast<double>(new_samples_ - 1) / sample_period_seconds : 0.0;
+
+	pugi::xml_node eye_gaze_node = item_file.document.append_child("eye_gaze");
+	eye_gaze_node.append_attribute("located_frames") = located_frames_;
+	eye_gaze_node.append_attribute("invalid_frames") = invalid_frames_;
+	eye_gaze_node.append_attribute("new_samples") = new_samples_;
+
+	MakeNode(eye_gaze_node, "sample_rate", static_cast<float>(sample_rate), 1).append_attribute("unit") = "hz";
+
+	pugi::xml_node latency_node = eye_gaze_node.append_child("latency");
+	latency_node.append_attribute("unit") = "ms";
+	MakeNode(latency_node, "mean", static_cast<float>(latency_.mean), 2);
+	MakeNode(latency_node, "standard_deviation", static_cast<float>(latency_.StandardDeviation()), 2);
+	MakeNode(latency_node, "min", static_cast<float>(latency_.min), 2);
+	MakeNode(latency_node, "max", static_cast<float>(latency_.max), 2);
+
+	// the ring buffer only holds the most recent samples, so the distribution is over those
+	std::vector<XrDuration> latencies(ring_count_);
+	for (size_t i = 0; i < ring_count_; i++) {
+		latencies[i] = samples_[i].display_time - samples_[i].sample_time;
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	pugi::xml_node distribution_node = latency_node.append_child("distribution");
+	distribution_node.append_attribute("samples") = static_cast<uint64_t>(ring_count_);
+	for (const uint32_t percentile : {1u, 5u, 50u, 95u, 99u}) {
+		const std::string name = "p" + std::to_string(percentile);
+		MakeNode(distribution_node, name.c_str(), static_cast<float>(static_cast<double>(SortedPercentile(latencies, percentile)) / 1e6), 2);
+	}
+
+	out_itemset.output_files.emplace_back(std::move(item_file));
+
+	return true;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "items/item.h"
+#include "pugixml.hpp"
+#include "util/util_statistics.h"
+
+// One located gaze pose, with the time the eye tracker sampled it
+struct EyeGazeSample {
+	XrTime display_time;
+	XrTime sample_time;
+	XrSpaceLocationFlags location_flags;
+	XrPosef pose;
+};
+
+// Locates the gaze pose of XR_EXT_eye_gaze_interaction every frame, to measure how often the eye tracker samples the gaze and how
+// old each sample is at the display time it was located for.
+//
+// The gaze is bound by an action of type "eye_gaze" in the inputs item set, so the inputs item set must be enabled too.
+// New samples are kept in a ring buffer allocated up front, and the latency percentiles are taken over the samples still in it.
+class EyeGazeItemSet : public IItemSet {
+   public:
+	explicit EyeGazeItemSet(pugi::xml_node eye_gaze_config);
+
+	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
+	bool IsSupported(const XrpContext& context) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
+	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
+
+   private:
+	pugi::xml_node config_;
+
+	// "/user/eyes_ext" followed by the binding, e.g. "/user/eyes_ext/input/gaze_ext/pose"
+	std::string gaze_binding_;
+	XrSpace gaze_space_ = XR_NULL_HANDLE;
+
+	std::vector<EyeGazeSample> samples_;
+	// next sample in the ring buffer to write to
+	size_t sample_index_ = 0;
+	// number of samples in the ring buffer, up to its size
+	size_t ring_count_ = 0;
+
+	// milliseconds from the time the gaze was sampled to the first display time it was located for, over every new sample
+	RunningStatistics latency_;
+
+	XrTime first_sample_time_ = 0;
+	XrTime last_sample_time_ = 0;
+	// samples with a sample time different from the previous sample
+	uint64_t new_samples_ = 0;
+
+	// frames the gaze was located in, and how many of those didn't have a valid gaze
+	uint64_t located_frames_ = 0;
+	uint64_t invalid_frames_ = 0;
+
+	// number of frames to locate the gaze in
+	uint32_t sample_count_ = 1;
+};
@@ -0,0 +1,285 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "face.h"
+
+#include <algorithm>
+
+#include "xr/xrp.h"
+
+// e.g. "jaw_drop"
+static const char* GetFaceExpressionName(size_t expression) {
+	static const char* const names[] = {
+		"brow_lowerer_l",
+		"brow_lowerer_r",
+		"cheek_puff_l",
+		"cheek_puff_r",
+		"cheek_raiser_l",
+		"cheek_raiser_r",
+		"cheek_suck_l",
+		"cheek_suck_r",
+		"chin_raiser_b",
+		"chin_raiser_t",
+		"dimpler_l",
+		"dimpler_r",
+		"eyes_closed_l",
+		"eyes_closed_r",
+		"eyes_look_down_l",
+		"eyes_look_down_r",
+		"eyes_look_left_l",
+		"eyes_look_left_r",
+		"eyes_look_right_l",
+		"eyes_look_right_r",
+		"eyes_look_up_l",
+		"eyes_look_up_r",
+		"inner_brow_raiser_l",
+		"inner_brow_raiser_r",
+		"jaw_drop",
+		"jaw_sideways_left",
+		"jaw_sideways_right",
+		"jaw_thrust",
+		"lid_tightener_l",
+		"lid_tightener_r",
+		"lip_corner_depressor_l",
+		"lip_corner_depressor_r",
+		"lip_corner_puller_l",
+		"lip_corner_puller_r",
+		"lip_funneler_lb",
+		"lip_funneler_lt",
+		"lip_funneler_rb",
+		"lip_funneler_rt",
+		"lip_pressor_l",
+		"lip_pressor_r",
+		"lip_pucker_l",
+		"lip_pucker_r",
+		"lip_stretcher_l",
+		"lip_stretcher_r",
+		"lip_suck_lb",
+		"lip_suck_lt",
+		"lip_suck_rb",
+		"lip_suck_rt",
+		"lip_tightener_l",
+		"lip_tightener_r",
+		"lips_toward",
+		"lower_lip_depressor_l",
+		"lower_lip_depressor_r",
+		"mouth_left",
+		"mouth_right",
+		"nose_wrinkler_l",
+		"nose_wrinkler_r",
+		"outer_brow_raiser_l",
+		"outer_brow_raiser_r",
+		"upper_lid_raiser_l",
+		"upper_lid_raiser_r",
+		"upper_lip_raiser_l",
+		"upper_lip_raiser_r",
+	};
+	static_assert(sizeof(names) / sizeof(names[0]) == face_expression_count, "every expression needs a name");
+
+	return expression < face_expression_count ? names[expression] : "unknown";
+}
+
+static const char* GetFaceConfidenceName(size_t confidence) {
+	static const char* const names[face_confidence_count] = {
+		"lower_face",
+		"upper_face",
+	};
+
+	return confidence < face_confidence_count ? names[confidence] : "unknown";
+}
+
+void FaceExpressionStatistics::Add(const float (&weights)[face_expression_count]) {
+	if (count == 0) {
+		std::copy(std::begin(weights), std::end(weights), min);
+		std::copy(std::begin(weights), std::end(weights), max);
+		std::copy(std::begin(weights), std::end(weights), previous);
+	}
+
+	count++;
+	const double inverse_count = 1.0 / static_cast<double>(count);
+
+	for (size_t i = 0; i < face_expression_count; i++) {
+		min[i] = std::min(min[i], weights[i]);
+		max[i] = std::max(max[i], weights[i]);
+		mean[i] += (weights[i] - mean[i]) * inverse_count;
+
+		update_count[i] += weights[i] != previous[i] ? 1 : 0;
+		previous[i] = weights[i];
+	}
+}
+
+FaceItemSet::FaceItemSet(pugi::xml_node face_config) {
+	config_ = face_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+}
+
+bool FaceItemSet::GetRequiredExtensions(std::set<std::string>& out_extensions) {
+	out_extensions.emplace(XR_FB_FACE_TRACKING_EXTENSION_NAME);
+
+	return true;
+}
+
+bool FaceItemSet::IsSupported(const XrpContext& context) {
+	if (!XrpIsExtensionAvailable(context, XR_FB_FACE_TRACKING_EXTENSION_NAME) || !context.dispatch.xrCreateFaceTrackerFB) {
+		XrpLog("Face tracking requires %s, which is not available", XR_FB_FACE_TRACKING_EXTENSION_NAME);
+		return false;
+	}
+
+	return true;
+}
+
+bool FaceItemSet::Init(XrpContext& context) {
+	destroy_face_tracker_ = context.dispatch.xrDestroyFaceTrackerFB;
+
+	XrFaceTrackerCreateInfoFB face_tracker_create_info = {
+		.type = XR_TYPE_FACE_TRACKER_CREATE_INFO_FB,
+		.next = nullptr,
+		// XR_FACE_EXPRESSION_SET_DEFAULT_FB, which is spelled differently in the vendor and Khronos headers
+		.faceExpressionSet = static_cast<XrFaceExpressionSetFB>(0),
+	};
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrCreateFaceTrackerFB(context.session, &face_tracker_create_info, &face_tracker_));
+
+	XrTime now;
+	measure_latency_ = XrpGetCurrentXrTime(context, now);
+	if (!measure_latency_) {
+		XrpLog("The runtime's clock can't be read, face tracking latency will not be measured");
+	}
+
+	return true;
+}
+
+bool FaceItemSet::Sample(const XrpContext& context, bool& out_complete) {
+	out_complete = expression_statistics_.count >= sample_count_;
+	if (out_complete) {
+		return true;
+	}
+
+	if (!context.dispatch.xrGetFaceExpressionWeightsFB || face_tracker_ == XR_NULL_HANDLE) {
+		XrpLog("Face tracking was not initialized");
+		return false;
+	}
+
+	XrFaceExpressionInfoFB expression_info = {
+		.type = XR_TYPE_FACE_EXPRESSION_INFO_FB,
+		.next = nullptr,
+		.time = context.current_frame_state.predictedDisplayTime,
+	};
+	XrFaceExpressionWeightsFB expression_weights = {
+		.type = XR_TYPE_FACE_EXPRESSION_WEIGHTS_FB,
+		.next = nullptr,
+		.weightCount = face_expression_count,
+		.weights = weights_,
+		.confidenceCount = face_confidence_count,
+		.confidences = confidences_,
+	};
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrGetFaceExpressionWeightsFB(face_tracker_, &expression_info, &expression_weights));
+
+	XrTime now = 0;
+	if (measure_latency_ && !XrpGetCurrentXrTime(context, now)) {
+		return false;
+	}
+
+	queried_frames_++;
+
+	if (!expression_weights.status.isValid) {
+		invalid_frames_++;
+		return true;
+	}
+
+	// the runtime returns the latest sample it has, which is the same for every frame until the tracker updates
+	if (expression_statistics_.count > 0 && expression_weights.time == last_sample_time_) {
+		return true;
+	}
+
+	if (expression_statistics_.count == 0) {
+		first_sample_time_ = expression_weights.time;
+	}
+	last_sample_time_ = expression_weights.time;
+
+	expression_statistics_.Add(weights_);
+	for (size_t i = 0; i < face_confidence_count; i++) {
+		confidence_statistics_[i].Add(confidences_[i]);
+	}
+
+	if (measure_latency_) {
+		latency_.Add(static_cast<double>(now - expression_weights.time) / 1e6);
+	}
+	display_latency_.Add(static_cast<double>(expression_info.time - expression_weights.time) / 1e6);
+
+	out_complete = expression_statistics_.count >= sample_count_;
+
+	return true;
+}
+
+static void MakeStatisticsNodes(pugi::xml_node& node, const RunningStatistics& statistics, int precision) {
+	MakeNode(node, "mean", static_cast<float>(statistics.mean), precision);
+	MakeNode(node, "min", static_cast<float>(statistics.min), precision);
+	MakeNode(node, "max", static_cast<float>(statistics.max), precision);
+}
+
+bool FaceItemSet::GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) {
+	if (expression_statistics_.count == 0) {
+		XrpLog("No samples were taken for the face.");
+		return false;
+	}
+
+	ItemFile item_file = {
+		.name = "face",
+	};
+
+	// the rate the tracker produced new samples at, rather than the rate they were requested
+	const double sample_period_seconds = static_cast<double>(last_sample_time_ - first_sample_time_) / 1e9;
+	const double update_rate =
+		sample_period_seconds > 0.0 ? static_cast<double>(expression_statistics_.count - 1) / sample_period_seconds : 0.0;
+
+	pugi::xml_node face_node = item_file.document.append_child("face");
+	face_node.append_attribute("samples") = expression_statistics_.count;
+	face_node.append_attribute("queried_frames") = queried_frames_;
+	face_node.append_attribute("invalid_frames") = invalid_frames_;
+
+	MakeNode(face_node, "update_rate", static_cast<float>(update_rate), 1).append_attribute("unit") = "hz";
+
+	if (measure_latency_) {
+		pugi::xml_node latency_node = face_node.append_child("latency");
+		latency_node.append_attribute("unit") = "ms";
+		MakeStatisticsNodes(latency_node, latency_, 2);
+	}
+
+	{
+		pugi::xml_node display_latency_node = face_node.append_child("display_latency");
+		display_latency_node.append_attribute("unit") = "ms";
+		MakeStatisticsNodes(display_latency_node, display_latency_, 2);
+	}
+
+	for (size_t i = 0; i < face_confidence_count; i++) {
+		pugi::xml_node confidence_node = face_node.append_child("confidence");
+		confidence_node.append_attribute("name") = GetFaceConfidenceName(i);
+		MakeStatisticsNodes(confidence_node, confidence_statistics_[i], 3);
+	}
+
+	for (size_t i = 0; i < face_expression_count; i++) {
+		pugi::xml_node expression_node = face_node.append_child("expression");
+		expression_node.append_attribute("name") = GetFaceExpressionName(i);
+
+		MakeNode(expression_node, "mean", static_cast<float>(expression_statistics_.mean[i]), 3);
+		MakeNode(expression_node, "min", expression_statistics_.min[i], 3);
+		MakeNode(expression_node, "max", expression_statistics_.max[i], 3);
+
+		const double expression_update_rate =
+			sample_period_seconds > 0.0 ? static_cast<double>(expression_statistics_.update_count[i]) / sample_period_seconds : 0.0;
+		MakeNode(expression_node, "update_rate", static_cast<float>(expression_update_rate), 1).append_attribute("unit") = "hz";
+	}
+
+	out_itemset.output_files.emplace_back(std::move(item_file));
+
+	return true;
+}
+
+FaceItemSet::~FaceItemSet() {
+	if (face_tracker_ != XR_NULL_HANDLE && destroy_face_tracker_) {
+		destroy_face_tracker_(face_tracker_);
+	}
+}
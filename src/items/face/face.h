@@ -0,0 +1,78 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <string>
+
+#include "items/item.h"
+#include "pugixml.hpp"
+#include "util/util_statistics.h"
+
+static constexpr size_t face_expression_count = XR_FACE_EXPRESSION_COUNT_FB;
+static constexpr size_t face_confidence_count = XR_FACE_CONFIDENCE_COUNT_FB;
+
+// Statistics of every expression weight over the tracking samples, with one contiguous array per statistic so every expression is
+// updated in a single loop
+struct FaceExpressionStatistics {
+	uint64_t count = 0;
+
+	float min[face_expression_count] = {};
+	float max[face_expression_count] = {};
+	double mean[face_expression_count] = {};
+
+	// number of samples where the weight was different from the previous sample
+	uint64_t update_count[face_expression_count] = {};
+	float previous[face_expression_count] = {};
+
+	void Add(const float (&weights)[face_expression_count]);
+};
+
+// Samples the expression weights of XR_FB_face_tracking every frame, to measure the range of each expression, how often the runtime
+// updates them and how old they are when they are returned.
+class FaceItemSet : public IItemSet {
+   public:
+	explicit FaceItemSet(pugi::xml_node face_config);
+
+	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
+	bool IsSupported(const XrpContext& context) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
+	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
+
+	~FaceItemSet() override;
+
+   private:
+	pugi::xml_node config_;
+
+	XrFaceTrackerFB face_tracker_ = XR_NULL_HANDLE;
+	// destructors don't have the context
+	PFN_xrDestroyFaceTrackerFB destroy_face_tracker_ = nullptr;
+
+	// xrGetFaceExpressionWeightsFB writes here
+	float weights_[face_expression_count] = {};
+	float confidences_[face_confidence_count] = {};
+
+	FaceExpressionStatistics expression_statistics_;
+	RunningStatistics confidence_statistics_[face_confidence_count];
+
+	// only measured if the runtime's clock can be read
+	bool measure_latency_ = false;
+	// milliseconds from the time a sample was tracked to when it was returned
+	RunningStatistics latency_;
+	// milliseconds from the time a sample was tracked to the display time it was requested for
+	RunningStatistics display_latency_;
+
+	XrTime first_sample_time_ = 0;
+	XrTime last_sample_time_ = 0;
+
+	// frames the weights were requested in, and how many of those had no valid weights
+	uint64_t queried_frames_ = 0;
+	uint64_t invalid_frames_ = 0;
+
+	// number of tracking samples to collect
+	uint32_t sample_count_ = 1;
+};
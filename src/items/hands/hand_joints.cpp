@@ -0,0 +1,57 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "hand_joints.h"
+
+void HandJointFrame::Load(const XrHandJointLocationEXT* joint_locations) {
+	poses.Load(joint_locations);
+
+	for (size_t i = 0; i < hand_joint_count; i++) {
+		radius[i] = joint_locations[i].radius;
+	}
+}
+
+void HandJointStatistics::Add(const HandJointFrame& frame) {
+	poses.Add(frame.poses);
+	JointWelfordAdd(radius_mean, radius_m2, frame.radius, 1.0 / static_cast<double>(poses.count));
+}
+
+float HandJointStatistics::GetMeanRadius(size_t joint) const { return static_cast<float>(radius_mean[joint]); }
+
+float HandJointStatistics::GetRadiusStandardDeviation(size_t joint) const { return JointStandardDeviation(radius_m2[joint], poses.count); }
+
+const char* GetHandJointName(size_t joint) {
+	static const char* const names[hand_joint_count] = {
+		"palm",
+		"wrist",
+		"thumb_metacarpal",
+		"thumb_proximal",
+		"thumb_distal",
+		"thumb_tip",
+		"index_metacarpal",
+		"index_proximal",
+		"index_intermediate",
+		"index_distal",
+		"index_tip",
+		"middle_metacarpal",
+		"middle_proximal",
+		"middle_intermediate",
+		"middle_distal",
+		"middle_tip",
+		"ring_metacarpal",
+		"ring_proximal",
+		"ring_intermediate",
+		"ring_distal",
+		"ring_tip",
+		"little_metacarpal",
+		"little_proximal",
+		"little_intermediate",
+		"little_distal",
+		"little_tip",
+	};
+
+	return joint < hand_joint_count ? names[joint] : "unknown";
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <cstdint>
+
+#include "util/util_joint_statistics.h"
+#include "xr/xrp.h"
+
+static constexpr size_t hand_joint_count = XR_HAND_JOINT_COUNT_EXT;
+
+// Every joint of one hand, in the structure of arrays layout of JointPoseFrame
+struct HandJointFrame {
+	JointPoseFrame<hand_joint_count> poses;
+	float radius[hand_joint_count];
+
+	// transposes the joint locations returned by xrLocateHandJointsEXT
+	void Load(const XrHandJointLocationEXT* joint_locations);
+};
+
+// All joints of a hand are located together, so they share one sample count
+struct HandJointStatistics {
+	JointPoseStatistics<hand_joint_count> poses;
+
+	double radius_mean[hand_joint_count] = {};
+	double radius_m2[hand_joint_count] = {};
+
+	void Add(const HandJointFrame& frame);
+
+	uint64_t GetSampleCount() const { return poses.count; }
+	float GetMeanRadius(size_t joint) const;
+	float GetRadiusStandardDeviation(size_t joint) const;
+
+	void Reset() { *this = {}; }
+};
+
+// e.g. "index_proximal"
+const char* GetHandJointName(size_t joint);
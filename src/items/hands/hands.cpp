@@ -0,0 +1,204 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "hands.h"
+
+#include <algorithm>
+
+#include "xr/xrp.h"
+
+HandItemSet::HandItemSet(pugi::xml_node hands_config) {
+	config_ = hands_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+	base_binding_ = config_.attribute("base_binding").as_string("/input/grip/pose");
+
+	hands_[0].hand = XR_HAND_LEFT_EXT;
+	hands_[0].user_path = "/user/hand/left";
+	hands_[1].hand = XR_HAND_RIGHT_EXT;
+	hands_[1].user_path = "/user/hand/right";
+}
+
+bool HandItemSet::GetRequiredExtensions(std::set<std::string>& out_extensions) {
+	out_extensions.emplace(XR_EXT_HAND_TRACKING_EXTENSION_NAME);
+
+	return true;
+}
+
+bool HandItemSet::IsSupported(const XrpContext& context) {
+	if (!XrpIsExtensionAvailable(context, XR_EXT_HAND_TRACKING_EXTENSION_NAME) || !context.dispatch.xrCreateHandTrackerEXT) {
+		XrpLog("Hand tracking requires %s, which is not available", XR_EXT_HAND_TRACKING_EXTENSION_NAME);
+		return false;
+	}
+
+	return true;
+}
+
+bool HandItemSet::Init(XrpContext& context) {
+	destroy_hand_tracker_ = context.dispatch.xrDestroyHandTrackerEXT;
+
+	for (Hand& hand : hands_) {
+		XrHandTrackerCreateInfoEXT hand_tracker_create_info = {
+			.type = XR_TYPE_HAND_TRACKER_CREATE_INFO_EXT,
+			.next = nullptr,
+			.hand = hand.hand,
+			.handJointSet = XR_HAND_JOINT_SET_DEFAULT_EXT,
+		};
+		XRP_CHECK_OR_RETURN(context, context.dispatch.xrCreateHandTrackerEXT(context.session, &hand_tracker_create_info, &hand.hand_tracker));
+	}
+
+	return true;
+}
+
+bool HandItemSet::LocateJoints(const XrpContext& context, Hand& hand, bool& out_located) {
+	out_located = false;
+
+	XrHandJointsLocateInfoEXT locate_info = {
+		.type = XR_TYPE_HAND_JOINTS_LOCATE_INFO_EXT,
+		.next = nullptr,
+		.baseSpace = hand.base_space,
+		.time = context.current_frame_state.predictedDisplayTime,
+	};
+	XrHandJointLocationsEXT joint_locations = {
+		.type = XR_TYPE_HAND_JOINT_LOCATIONS_EXT,
+		.next = nullptr,
+		.jointCount = static_cast<uint32_t>(hand.joint_locations.size()),
+		.jointLocations = hand.joint_locations.data(),
+	};
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrLocateHandJointsEXT(hand.hand_tracker, &locate_info, &joint_locations));
+
+	if (!joint_locations.isActive) {
+		XrpLog("%s is not being tracked.", hand.user_path.c_str());
+		return true;
+	}
+
+	for (size_t i = 0; i < hand.joint_locations.size(); i++) {
+		const XrSpaceLocationFlags required_flags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT;
+		if ((hand.joint_locations[i].locationFlags & required_flags) != required_flags) {
+			XrpLog("Joint %s of %s could not be located.", GetHandJointName(i), hand.user_path.c_str());
+			return true;
+		}
+	}
+
+	hand.frame.Load(hand.joint_locations.data());
+	out_located = true;
+
+	return true;
+}
+
+bool HandItemSet::Sample(const XrpContext& context, bool& out_complete) {
+	out_complete = sampled_frames_ >= sample_count_;
+	if (out_complete) {
+		return true;
+	}
+
+	if (!context.dispatch.xrLocateHandJointsEXT || hands_[0].hand_tracker == XR_NULL_HANDLE || hands_[1].hand_tracker == XR_NULL_HANDLE) {
+		XrpLog("Hand tracking was not initialized");
+		return false;
+	}
+
+	// the base spaces are only looked up once every item set has been initialized
+	if (hands_[0].base_space == XR_NULL_HANDLE) {
+		output_base_binding_ = base_binding_;
+
+		for (Hand& hand : hands_) {
+			const auto action_space = context.action_spaces.find(hand.user_path + base_binding_);
+			if (action_space == context.action_spaces.end()) {
+				XrpLog("No action is bound to %s%s. Hand joints will be located in the reference space", hand.user_path.c_str(),
+					   base_binding_.c_str());
+				output_base_binding_.clear();
+				break;
+			}
+
+			hand.base_space = action_space->second;
+		}
+
+		// both hands must be in the same space
+		if (output_base_binding_.empty()) {
+			for (Hand& hand : hands_) {
+				hand.base_space = context.reference_space;
+			}
+		}
+	}
+
+	for (Hand& hand : hands_) {
+		bool located = false;
+		if (!LocateJoints(context, hand, located)) {
+			return false;
+		}
+
+		if (!located) {
+			rejected_frames_++;
+			return true;
+		}
+	}
+
+	// only accumulate once both hands were located, so both hands have the same number of samples
+	for (Hand& hand : hands_) {
+		hand.statistics.Add(hand.frame);
+	}
+
+	sampled_frames_++;
+	out_complete = sampled_frames_ >= sample_count_;
+
+	return true;
+}
+
+bool HandItemSet::GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) {
+	ItemFile item_file = {
+		.name = "hands",
+	};
+
+	pugi::xml_node hands_node = item_file.document.append_child("hands");
+	hands_node.append_attribute("base") = output_base_binding_.c_str();
+	if (rejected_frames_ > 0) {
+		hands_node.append_attribute("rejected_frames") = rejected_frames_;
+	}
+
+	for (const Hand& hand : hands_) {
+		const HandJointStatistics& statistics = hand.statistics;
+		if (statistics.GetSampleCount() == 0) {
+			XrpLog("No samples were taken for %s.", hand.user_path.c_str());
+			return false;
+		}
+
+		pugi::xml_node hand_node = hands_node.append_child("hand");
+		hand_node.append_attribute("path") = hand.user_path.c_str();
+		if (statistics.GetSampleCount() > 1) {
+			hand_node.append_attribute("samples") = statistics.GetSampleCount();
+		}
+
+		for (size_t i = 0; i < hand_joint_count; i++) {
+			pugi::xml_node joint_node = hand_node.append_child("joint");
+			joint_node.append_attribute("name") = GetHandJointName(i);
+
+			MakePoseNodes(joint_node, statistics.poses.GetMeanPose(i), statistics.GetSampleCount(), statistics.poses.GetPositionStandardDeviation(i),
+						  statistics.poses.GetOrientationStandardDeviation(i));
+
+			{
+				pugi::xml_node radius_node = MakeNode(joint_node, "radius", statistics.GetMeanRadius(i), 4);
+				radius_node.append_attribute("unit") = "meters";
+
+				if (statistics.GetSampleCount() > 1) {
+					char buffer[XRP_FLOAT_STRING_SIZE];
+					XrpFormatFloat(statistics.GetRadiusStandardDeviation(i), 4, buffer, sizeof(buffer));
+					radius_node.append_attribute("standard_deviation") = buffer;
+				}
+			}
+		}
+	}
+
+	out_itemset.output_files.emplace_back(std::move(item_file));
+
+	return true;
+}
+
+HandItemSet::~HandItemSet() {
+	for (const Hand& hand : hands_) {
+		if (hand.hand_tracker != XR_NULL_HANDLE && destroy_hand_tracker_) {
+			destroy_hand_tracker_(hand.hand_tracker);
+		}
+	}
+}
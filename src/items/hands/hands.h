@@ -0,0 +1,64 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "hand_joints.h"
+#include "items/item.h"
+#include "pugixml.hpp"
+
+// Locates every joint of both hands with XR_EXT_hand_tracking, relative to an action space published by another item set
+// (the grip pose by default), so the runtime's joint layout can be compared against its grip and palm poses.
+class HandItemSet : public IItemSet {
+   public:
+	explicit HandItemSet(pugi::xml_node hands_config);
+
+	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
+	bool IsSupported(const XrpContext& context) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
+	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
+
+	~HandItemSet() override;
+
+   private:
+	struct Hand {
+		XrHandEXT hand;
+		std::string user_path;
+
+		XrHandTrackerEXT hand_tracker = XR_NULL_HANDLE;
+		// XR_NULL_HANDLE until the first sample, as the action space is created by another item set
+		XrSpace base_space = XR_NULL_HANDLE;
+
+		std::array<XrHandJointLocationEXT, hand_joint_count> joint_locations;
+		HandJointFrame frame;
+		HandJointStatistics statistics;
+	};
+
+	// out_located is false if the hand isn't tracked, or not every joint could be located
+	bool LocateJoints(const XrpContext& context, Hand& hand, bool& out_located);
+
+	pugi::xml_node config_;
+
+	// appended to each hand's user path to find the space to locate joints in
+	std::string base_binding_;
+	// empty if there was no action space for the base binding, and the joints were located in the reference space
+	std::string output_base_binding_;
+
+	std::array<Hand, 2> hands_;
+
+	// destructors don't have the context
+	PFN_xrDestroyHandTrackerEXT destroy_hand_tracker_ = nullptr;
+
+	// number of frames to sample the joints over
+	uint32_t sample_count_ = 1;
+	uint32_t sampled_frames_ = 0;
+	// frames where either hand couldn't be located
+	uint64_t rejected_frames_ = 0;
+};
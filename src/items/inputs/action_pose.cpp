@@ -6,43 +6,123 @@
 
 #include "action_pose.h"
 
+#include <algorithm>
 #include <utility>
 
 #include "util/util_file.h"
 
+void PoseStatistics::Add(const XrPosef& pose) {
+	position[0].Add(pose.position.x);
+	position[1].Add(pose.position.y);
+	position[2].Add(pose.position.z);
+
+	// q and -q are the same rotation, so keep every sample in the same hemisphere as the mean before averaging
+	XrQuaternionf q = pose.orientation;
+	if (orientation[0].count > 0) {
+		const double dot = orientation[0].mean * q.w + orientation[1].mean * q.x + orientation[2].mean * q.y + orientation[3].mean * q.z;
+		if (dot < 0.0) {
+			q = {.x = -q.x, .y = -q.y, .z = -q.z, .w = -q.w};
+		}
+	}
+
+	orientation[0].Add(q.w);
+	orientation[1].Add(q.x);
+	orientation[2].Add(q.y);
+	orientation[3].Add(q.z);
+}
+
+XrPosef PoseStatistics::GetMeanPose() const {
+	return XrpMakeMeanPose({orientation[0].mean, orientation[1].mean, orientation[2].mean, orientation[3].mean},
+						   {position[0].mean, position[1].mean, position[2].mean});
+}
+
+void PoseStatistics::Reset() {
+	for (RunningStatistics& statistics : position) statistics.Reset();
+	for (RunningStatistics& statistics : orientation) statistics.Reset();
+}
+
+void VelocityStatistics::Add(const XrSpaceVelocity& velocity) {
+	frames++;
+
+	if (velocity.velocityFlags & XR_SPACE_VELOCITY_LINEAR_VALID_BIT) {
+		const XrVector3f& v = velocity.linearVelocity;
+		linear[0].Add(v.x);
+		linear[1].Add(v.y);
+		linear[2].Add(v.z);
+		linear_speed.Add(std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z));
+	}
+
+	if (velocity.velocityFlags & XR_SPACE_VELOCITY_ANGULAR_VALID_BIT) {
+		const XrVector3f& w = velocity.angularVelocity;
+		angular[0].Add(w.x);
+		angular[1].Add(w.y);
+		angular[2].Add(w.z);
+		angular_speed.Add(std::sqrt(w.x * w.x + w.y * w.y + w.z * w.z));
+	}
+}
+
+void VelocityStatistics::Reset() { *this = {}; }
+
 PoseInput::PoseInput(PoseActionInfo action_info) : action_info_(std::move(action_info)){};
 
-bool PoseInput::Init(const XrpContext& context, const XrActionSet& action_set, const std::shared_ptr<PoseInput>& base_pose) {
+bool PoseInput::InitPaths(const XrpContext& context, const std::shared_ptr<PoseInput>& base_pose) {
 	base_pose_ = base_pose;
 
-	{
-		std::vector<XrPath> subaction_paths{};
+	if (base_pose_) {
+		const std::vector<std::string> base_subaction_paths = base_pose_->GetActionInfo().subaction_paths;
 		for (const std::string& subaction : action_info_.subaction_paths) {
-			subaction_paths.emplace_back(XrpStringToXrPath(context, subaction));
+			const auto base_subaction = std::find(base_subaction_paths.begin(), base_subaction_paths.end(), subaction);
+			if (base_subaction == base_subaction_paths.end()) {
+				XrpLog("Base of %s does not have subaction path: %s", action_info_.name.c_str(), subaction.c_str());
+				return false;
+			}
+
+			base_subaction_indices_.push_back(base_subaction - base_subaction_paths.begin());
 		}
+	}
+
+	// resolve every path up front so sampling never has to convert strings
+	for (const std::string& subaction : action_info_.subaction_paths) {
+		subaction_xr_paths_.push_back(XrpStringToXrPath(context, subaction));
+		binding_xr_paths_.push_back(XrpStringToXrPath(context, subaction + action_info_.suggested_binding));
+	}
+
+	interaction_profiles_.resize(action_info_.subaction_paths.size(), XR_NULL_PATH);
+	pose_statistics_.resize(action_info_.subaction_paths.size());
+
+	return true;
+}
+
+bool PoseInput::Init(const XrpContext& context, const XrActionSet& action_set, const std::shared_ptr<PoseInput>& base_pose) {
+	if (!InitPaths(context, base_pose)) {
+		return false;
+	}
+
+	{
 		XrActionCreateInfo action_create_info = {
 			.type = XR_TYPE_ACTION_CREATE_INFO,
 			.next = nullptr,
 			.actionType = XR_ACTION_TYPE_POSE_INPUT,
-			.countSubactionPaths = (uint32_t)subaction_paths.size(),
-			.subactionPaths = subaction_paths.data(),
+			.countSubactionPaths = (uint32_t)subaction_xr_paths_.size(),
+			.subactionPaths = subaction_xr_paths_.data(),
 		};
 
 		action_info_.name.copy(action_create_info.actionName, action_info_.name.size());
 		action_info_.name.copy(action_create_info.localizedActionName, action_info_.name.size());
 
-		XRP_CHECK_OR_RETURN(context, xrCreateAction(action_set, &action_create_info, &pose_action_));
+		XRP_CHECK_OR_RETURN(context, context.dispatch.xrCreateAction(action_set, &action_create_info, &pose_action_));
 	}
 
-	for (const std::string& subaction : action_info_.subaction_paths) {
+	for (size_t i = 0; i < action_info_.subaction_paths.size(); i++) {
 		XrActionSpaceCreateInfo space_create_info = {
 			.type = XR_TYPE_ACTION_SPACE_CREATE_INFO,
 			.next = nullptr,
 			.action = pose_action_,
-			.subactionPath = XrpStringToXrPath(context, subaction),
+			.subactionPath = subaction_xr_paths_[i],
 			.poseInActionSpace = xrp_identity_pose,
 		};
-		XRP_CHECK_OR_RETURN(context, xrCreateActionSpace(context.session, &space_create_info, &action_spaces_[subaction]));
+		XRP_CHECK_OR_RETURN(context,
+							context.dispatch.xrCreateActionSpace(context.session, &space_create_info, &action_spaces_[action_info_.subaction_paths[i]]));
 	}
 
 	return true;
@@ -50,12 +130,18 @@ bool PoseInput::Init(const XrpContext& context, const XrActionSet& action_set, c
 
 XrSpace PoseInput::GetActionSpace(const std::string& subaction_path) { return action_spaces_[subaction_path]; }
 
+void PoseInput::AppendActionSpaces(std::vector<XrSpace>& out_action_spaces) {
+	space_index_ = out_action_spaces.size();
+
+	for (const std::string& subaction : action_info_.subaction_paths) {
+		out_action_spaces.push_back(action_spaces_[subaction]);
+	}
+}
+
 PoseActionInfo PoseInput::GetActionInfo() { return action_info_; }
 
 bool PoseInput::GetSuggestedBinding(const XrpContext& context, std::vector<XrActionSuggestedBinding>& out_suggested_bindings) {
-	for (const std::string& subaction_path : action_info_.subaction_paths) {
-		const XrPath binding_path = XrpStringToXrPath(context, subaction_path + action_info_.suggested_binding);
-
+	for (const XrPath binding_path : binding_xr_paths_) {
 		XrActionSuggestedBinding suggested_binding = {
 			.action = pose_action_,
 			.binding = binding_path,
@@ -67,27 +153,30 @@ bool PoseInput::GetSuggestedBinding(const XrpContext& context, std::vector<XrAct
 	return true;
 }
 
-bool PoseInput::GetPoseInfo(const XrpContext& context, PoseOutputInfo& out_pose_output_info) {
+bool PoseInput::Sample(const XrpContext& context, const std::vector<XrSpaceLocation>& space_locations,
+					   const std::vector<XrSpaceVelocity>* space_velocities, InputCaptureWriter* capture_writer) {
+	// reference poses are only located as the base of other poses
 	if (action_info_.reference) {
-		XrpLog("Skipping %s because it was defined as a reference pose", action_info_.name.c_str());
 		return true;
 	};
 
-	std::vector<PoseInfo> pose_infos;
+	sample_poses_.clear();
+	sample_location_flags_.clear();
+	sample_interaction_profiles_.clear();
 
-	for (const std::string& subaction : action_info_.subaction_paths) {
+	for (size_t i = 0; i < subaction_xr_paths_.size(); i++) {
 		{
 			XrActionStateGetInfo action_state_get_info = {
 				.type = XR_TYPE_ACTION_STATE_GET_INFO,
 				.next = nullptr,
 				.action = pose_action_,
-				.subactionPath = XrpStringToXrPath(context, subaction),
+				.subactionPath = subaction_xr_paths_[i],
 			};
 			XrActionStatePose pose_state = {
 				.type = XR_TYPE_ACTION_STATE_POSE,
 				.next = nullptr,
 			};
-			XRP_CHECK_OR_RETURN(context, xrGetActionStatePose(context.session, &action_state_get_info, &pose_state));
+			XRP_CHECK_OR_RETURN(context, context.dispatch.xrGetActionStatePose(context.session, &action_state_get_info, &pose_state));
 
 			if (!pose_state.isActive) {
 				XrpLog("pose %s is not active.", action_info_.name.c_str());
@@ -95,33 +184,141 @@ bool PoseInput::GetPoseInfo(const XrpContext& context, PoseOutputInfo& out_pose_
 			}
 		}
 
-		XrSpace pose_base_space = base_pose_ ? base_pose_->GetActionSpace(subaction) : context.reference_space;
-		XrSpaceLocation space_location = {.type = XR_TYPE_SPACE_LOCATION, .next = nullptr};
-		XRP_CHECK_OR_RETURN(
-			context, xrLocateSpace(action_spaces_[subaction], pose_base_space, context.current_frame_state.predictedDisplayTime, &space_location));
+		// every space was located relative to the reference space, so move into the base pose's space if there is one
+		const XrSpaceLocation& space_location = space_locations[space_index_ + i];
+		XrSpaceLocationFlags action_location_flags = space_location.locationFlags;
+		XrPosef action_pose = space_location.pose;
+		if (base_pose_) {
+			const XrSpaceLocation& base_space_location = space_locations[base_pose_->space_index_ + base_subaction_indices_[i]];
+			action_location_flags &= base_space_location.locationFlags;
+			action_pose = XrpGetRelativePose(base_space_location.pose, action_pose);
+		}
 
-		std::string interaction_profile;
-		if (!XrpGetInteractionProfileForUserPath(context, subaction, interaction_profile)) {
+		XrPath interaction_profile;
+		if (!XrpGetInteractionProfileForUserPath(context, subaction_xr_paths_[i], interaction_profile) || interaction_profile == XR_NULL_PATH) {
 			XrpLog("Failed to get interaction profile path");
 			return false;
 		}
 
-		XrPosef action_pose = space_location.pose;
-		StandardizeXrQuaternion(action_pose.orientation);
-
-		if (!(space_location.locationFlags & (XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT))) {
+		const XrSpaceLocationFlags required_flags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT;
+		if ((action_location_flags & required_flags) != required_flags) {
 			XrpLog("A pose component of %s was empty.", action_info_.name.c_str());
 			return false;
 		}
 
+		sample_poses_.push_back(action_pose);
+		sample_location_flags_.push_back(action_location_flags);
+		sample_interaction_profiles_.push_back(interaction_profile);
+	}
+
+	// only accumulate once every subaction was located, so all subactions have the same number of samples
+	for (size_t i = 0; i < sample_poses_.size(); i++) {
+		if (capture_writer) {
+			capture_writer->WriteSample({
+				.action = capture_writer->InternString(action_info_.name),
+				.subaction_path = capture_writer->InternPath(context, subaction_xr_paths_[i]),
+				.interaction_profile = capture_writer->InternPath(context, sample_interaction_profiles_[i]),
+				.time = context.current_frame_state.predictedDisplayTime,
+				.location_flags = sample_location_flags_[i],
+				.pose = sample_poses_[i],
+			});
+		}
+
+		AddSample(i, sample_interaction_profiles_[i], sample_poses_[i]);
+
+		if (space_velocities) {
+			velocity_statistics_.resize(sample_poses_.size());
+			velocity_statistics_[i].Add((*space_velocities)[space_index_ + i]);
+		}
+	}
+
+	return true;
+}
+
+bool PoseInput::ReplaySample(XrPath subaction_path, XrPath interaction_profile, const XrPosef& pose) {
+	const auto subaction = std::find(subaction_xr_paths_.begin(), subaction_xr_paths_.end(), subaction_path);
+	if (subaction == subaction_xr_paths_.end()) {
+		return false;
+	}
+
+	AddSample(subaction - subaction_xr_paths_.begin(), interaction_profile, pose);
+
+	return true;
+}
+
+void PoseInput::AddSample(size_t subaction_index, XrPath interaction_profile, XrPosef pose) {
+	// a different device is being used, the previous samples no longer apply
+	if (interaction_profiles_[subaction_index] != interaction_profile) {
+		interaction_profiles_[subaction_index] = interaction_profile;
+		pose_statistics_[subaction_index].Reset();
+		if (subaction_index < velocity_statistics_.size()) {
+			velocity_statistics_[subaction_index].Reset();
+		}
+	}
+
+	StandardizeXrQuaternion(pose.orientation);
+	pose_statistics_[subaction_index].Add(pose);
+}
+
+uint64_t PoseInput::GetSampleCount() const {
+	uint64_t sample_count = UINT64_MAX;
+	for (const PoseStatistics& pose_statistics : pose_statistics_) {
+		sample_count = std::min(sample_count, pose_statistics.GetSampleCount());
+	}
+
+	return pose_statistics_.empty() ? 0 : sample_count;
+}
+
+bool PoseInput::GetPoseInfo(const XrpContext& context, PoseOutputInfo& out_pose_output_info) {
+	if (action_info_.reference) {
+		XrpLog("Skipping %s because it was defined as a reference pose", action_info_.name.c_str());
+		return true;
+	};
+
+	std::vector<PoseInfo> pose_infos;
+
+	for (size_t i = 0; i < action_info_.subaction_paths.size(); i++) {
+		const std::string& subaction = action_info_.subaction_paths[i];
+		const PoseStatistics& pose_statistics = pose_statistics_[i];
+
+		// e.g. a controller that was never connected, or an action a replayed capture has no samples of
+		if (pose_statistics.GetSampleCount() == 0) {
+			XrpLog("No samples were taken for %s on %s. Skipping", action_info_.name.c_str(), subaction.c_str());
+			continue;
+		}
+
+		std::string interaction_profile;
+		if (!XrpXrPathToString(context, interaction_profiles_[i], interaction_profile)) {
+			XrpLog("Failed to get interaction profile path");
+			return false;
+		}
+
 		PoseInfo info = {
 			.action_name = action_info_.name,
 			.binding_path = subaction + action_info_.suggested_binding,
 			.interaction_profile = interaction_profile,
 			.base = base_pose_ ? subaction + base_pose_->GetActionInfo().suggested_binding : "",
-			.pose = action_pose,
+			.pose = pose_statistics.GetMeanPose(),
+			.sample_count = pose_statistics.GetSampleCount(),
+			.position_standard_deviation =
+				{
+					.x = static_cast<float>(pose_statistics.position[0].StandardDeviation()),
+					.y = static_cast<float>(pose_statistics.position[1].StandardDeviation()),
+					.z = static_cast<float>(pose_statistics.position[2].StandardDeviation()),
+				},
+			.orientation_standard_deviation =
+				{
+					.x = static_cast<float>(pose_statistics.orientation[1].StandardDeviation()),
+					.y = static_cast<float>(pose_statistics.orientation[2].StandardDeviation()),
+					.z = static_cast<float>(pose_statistics.orientation[3].StandardDeviation()),
+					.w = static_cast<float>(pose_statistics.orientation[0].StandardDeviation()),
+				},
 		};
 
+		if (i < velocity_statistics_.size()) {
+			info.velocity = velocity_statistics_[i];
+		}
+
 		pose_infos.emplace_back(info);
 	}
 
@@ -7,25 +7,66 @@
 #pragma once
 
 #include <map>
+#include <optional>
 #include <vector>
 
+#include "input_capture.h"
 #include "items/item.h"
+#include "util/util_statistics.h"
 #include "xr/xrp.h"
 
 struct PoseActionInfo {
 	std::string name;
 	bool reference;
+	// bound in the eye gaze interaction profile rather than the controller profiles
+	bool eye_gaze;
 	std::vector<std::string> subaction_paths;
 	std::string suggested_binding;
 	std::string base;
 };
 
+// Accumulates the velocities of a space located over many frames. Each component is only accumulated in frames where it's valid
+struct VelocityStatistics {
+	// X, Y, Z
+	RunningStatistics linear[3];
+	RunningStatistics angular[3];
+	RunningStatistics linear_speed;
+	RunningStatistics angular_speed;
+
+	// frames the velocity was requested in
+	uint64_t frames = 0;
+
+	void Add(const XrSpaceVelocity& velocity);
+	void Reset();
+};
+
 struct PoseInfo {
 	std::string action_name;
 	std::string binding_path;
 	std::string interaction_profile;
 	std::string base;
 	XrPosef pose;
+
+	uint64_t sample_count;
+	XrVector3f position_standard_deviation;
+	XrQuaternionf orientation_standard_deviation;
+
+	// only set if velocities were located. In the reference space, rather than relative to the base
+	std::optional<VelocityStatistics> velocity;
+};
+
+// Accumulates poses sampled over many frames without storing the individual samples
+struct PoseStatistics {
+	// X, Y, Z
+	RunningStatistics position[3];
+	// W, X, Y, Z
+	RunningStatistics orientation[4];
+
+	void Add(const XrPosef& pose);
+	XrPosef GetMeanPose() const;
+
+	uint64_t GetSampleCount() const { return position[0].count; }
+	void Reset();
 };
 
 struct PoseOutputInfo {
@@ -36,24 +77,37 @@ struct PoseOutputInfo {
 	std::vector<PoseInfo> pose_infos;
 };
 
-
-
 class PoseInput {
    public:
 	explicit PoseInput(PoseActionInfo action_info);
 
 	bool Init(const XrpContext& context, const XrActionSet& action_set, const std::shared_ptr<PoseInput>& base_pose);
+	// Resolves paths without creating the action or its spaces, for replaying a capture
+	bool InitPaths(const XrpContext& context, const std::shared_ptr<PoseInput>& base_pose);
 
 	XrSpace GetActionSpace(const std::string& subaction_path);
+	// Appends the action space of every subaction, in subaction order, so they can be located in one batch
+	void AppendActionSpaces(std::vector<XrSpace>& out_action_spaces);
 	PoseActionInfo GetActionInfo();
 
 	bool GetSuggestedBinding(const XrpContext& context, std::vector<XrActionSuggestedBinding>& out_suggested_bindings);
 
+	// Adds the current frame to the running statistics. space_locations are the batch located spaces from AppendActionSpaces, and
+	// space_velocities their velocities if those were located too. If capture_writer is set, every sample that is accumulated is
+	// also written to the capture
+	bool Sample(const XrpContext& context, const std::vector<XrSpaceLocation>& space_locations,
+				const std::vector<XrSpaceVelocity>* space_velocities, InputCaptureWriter* capture_writer);
+	// Adds a captured sample to the running statistics. Returns false if the subaction path isn't one of this action's
+	bool ReplaySample(XrPath subaction_path, XrPath interaction_profile, const XrPosef& pose);
+	uint64_t GetSampleCount() const;
+
 	bool GetPoseInfo(const XrpContext& context, PoseOutputInfo& out_pose_output_info);
 
 	~PoseInput();
 
    private:
+	void AddSample(size_t subaction_index, XrPath interaction_profile, XrPosef pose);
+
 	PoseActionInfo action_info_;
 
 	std::shared_ptr<PoseInput> base_pose_;
@@ -62,4 +116,22 @@ class PoseInput {
 
 	//subaction, space
 	std::map<std::string, XrSpace> action_spaces_;
+
+	// index of the first subaction's space in the batch of located spaces
+	size_t space_index_ = 0;
+	// index of each subaction in the base pose's subaction paths
+	std::vector<size_t> base_subaction_indices_;
+
+	// indexed the same as action_info_.subaction_paths
+	std::vector<XrPath> subaction_xr_paths_;
+	std::vector<XrPath> binding_xr_paths_;
+	std::vector<XrPath> interaction_profiles_;
+	std::vector<PoseStatistics> pose_statistics_;
+
+	// the current frame's samples, kept until every subaction has been located. Reused so sampling doesn't allocate every frame
+	std::vector<XrPosef> sample_poses_;
+	std::vector<XrSpaceLocationFlags> sample_location_flags_;
+	std::vector<XrPath> sample_interaction_profiles_;
+	// empty unless velocities are sampled
+	std::vector<VelocityStatistics> velocity_statistics_;
 };
\ No newline at end of file
@@ -0,0 +1,252 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "input_capture.h"
+
+#include <cstring>
+
+static constexpr char input_capture_magic[4] = {'C', 'P', 'T', 'C'};
+
+enum InputCaptureRecordType : uint8_t {
+	INPUT_CAPTURE_RECORD_STRING = 1,
+	INPUT_CAPTURE_RECORD_SAMPLE = 2,
+};
+
+// type + action, subaction path and interaction profile ids + time + location flags + 7 pose floats
+static constexpr size_t input_capture_sample_record_size = 1 + 3 * sizeof(uint32_t) + sizeof(XrTime) + sizeof(XrSpaceLocationFlags) + 7 * sizeof(float);
+
+static constexpr size_t input_capture_flush_size = 64 * 1024;
+
+bool InputCaptureWriter::Open(const std::string& file_name, const std::string& runtime_name) {
+	file_ = fopen(file_name.c_str(), "wb");
+	if (!file_) {
+		XrpLog("Failed to open capture file: %s", file_name.c_str());
+		return false;
+	}
+
+	buffer_.reserve(input_capture_flush_size + input_capture_sample_record_size);
+
+	const uint32_t runtime_name_length = static_cast<uint32_t>(runtime_name.size());
+	Append(input_capture_magic, sizeof(input_capture_magic));
+	Append(&input_capture_version, sizeof(input_capture_version));
+	Append(&runtime_name_length, sizeof(runtime_name_length));
+	Append(runtime_name.data(), runtime_name.size());
+
+	return Flush();
+}
+
+uint32_t InputCaptureWriter::InternString(const std::string& string) {
+	const auto interned_string = string_ids_.find(string);
+	if (interned_string != string_ids_.end()) {
+		return interned_string->second;
+	}
+
+	const uint32_t id = static_cast<uint32_t>(string_ids_.size());
+	string_ids_[string] = id;
+
+	const uint8_t type = INPUT_CAPTURE_RECORD_STRING;
+	const uint32_t length = static_cast<uint32_t>(string.size());
+	Append(&type, sizeof(type));
+	Append(&length, sizeof(length));
+	Append(string.data(), string.size());
+
+	return id;
+}
+
+uint32_t InputCaptureWriter::InternPath(const XrpContext& context, XrPath path) {
+	const auto interned_path = path_ids_.find(path);
+	if (interned_path != path_ids_.end()) {
+		return interned_path->second;
+	}
+
+	std::string path_string;
+	if (!XrpXrPathToString(context, path, path_string)) {
+		XrpLog("Failed to get string for captured path");
+	}
+
+	const uint32_t id = InternString(path_string);
+	path_ids_[path] = id;
+
+	return id;
+}
+
+void InputCaptureWriter::WriteSample(const InputCaptureSample& sample) {
+	if (!file_) {
+		return;
+	}
+
+	const uint8_t type = INPUT_CAPTURE_RECORD_SAMPLE;
+	const float pose[7] = {
+		sample.pose.position.x,	   sample.pose.position.y,	  sample.pose.position.z,	 sample.pose.orientation.x,
+		sample.pose.orientation.y, sample.pose.orientation.z, sample.pose.orientation.w,
+	};
+
+	Append(&type, sizeof(type));
+	Append(&sample.action, sizeof(sample.action));
+	Append(&sample.subaction_path, sizeof(sample.subaction_path));
+	Append(&sample.interaction_profile, sizeof(sample.interaction_profile));
+	Append(&sample.time, sizeof(sample.time));
+	Append(&sample.location_flags, sizeof(sample.location_flags));
+	Append(pose, sizeof(pose));
+
+	if (buffer_.size() >= input_capture_flush_size) {
+		Flush();
+	}
+}
+
+bool InputCaptureWriter::Flush() {
+	if (!file_ || buffer_.empty()) {
+		return file_ != nullptr;
+	}
+
+	const bool success = fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size() && fflush(file_) == 0;
+	buffer_.clear();
+
+	if (!success) {
+		XrpLog("Failed to write capture file");
+	}
+
+	return success;
+}
+
+void InputCaptureWriter::Append(const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+InputCaptureWriter::~InputCaptureWriter() {
+	if (file_) {
+		Flush();
+		fclose(file_);
+	}
+}
+
+// Reads fields out of the file contents, failing once the end is reached
+class InputCaptureReader {
+   public:
+	InputCaptureReader(const uint8_t* data, size_t size) : data_(data), end_(data + size) {}
+
+	bool Read(void* out_data, size_t size) {
+		if (static_cast<size_t>(end_ - data_) < size) {
+			return false;
+		}
+
+		memcpy(out_data, data_, size);
+		data_ += size;
+
+		return true;
+	}
+
+	bool ReadString(std::string& out_string) {
+		uint32_t length;
+		if (!Read(&length, sizeof(length)) || static_cast<size_t>(end_ - data_) < length) {
+			return false;
+		}
+
+		out_string.assign(reinterpret_cast<const char*>(data_), length);
+		data_ += length;
+
+		return true;
+	}
+
+	bool AtEnd() const { return data_ == end_; }
+	size_t GetRemaining() const { return end_ - data_; }
+
+   private:
+	const uint8_t* data_;
+	const uint8_t* end_;
+};
+
+bool ReadInputCapture(const std::string& file_name, InputCapture& out_capture) {
+	std::vector<uint8_t> contents;
+	{
+		FILE* file = fopen(file_name.c_str(), "rb");
+		if (!file) {
+			XrpLog("Failed to open capture file: %s", file_name.c_str());
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		const long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		contents.resize(size > 0 ? static_cast<size_t>(size) : 0);
+		const bool success = fread(contents.data(), 1, contents.size(), file) == contents.size();
+		fclose(file);
+
+		if (!success) {
+			XrpLog("Failed to read capture file: %s", file_name.c_str());
+			return false;
+		}
+	}
+
+	InputCaptureReader reader(contents.data(), contents.size());
+
+	char magic[sizeof(input_capture_magic)];
+	uint32_t version;
+	if (!reader.Read(magic, sizeof(magic)) || memcmp(magic, input_capture_magic, sizeof(magic)) != 0 || !reader.Read(&version, sizeof(version))) {
+		XrpLog("%s is not a capture file", file_name.c_str());
+		return false;
+	}
+
+	if (version != input_capture_version) {
+		XrpLog("Unsupported capture version %u in %s", version, file_name.c_str());
+		return false;
+	}
+
+	if (!reader.ReadString(out_capture.runtime_name)) {
+		XrpLog("Capture file %s is truncated", file_name.c_str());
+		return false;
+	}
+
+	// nearly every record is a sample
+	out_capture.samples.reserve(reader.GetRemaining() / input_capture_sample_record_size);
+
+	while (!reader.AtEnd()) {
+		uint8_t type;
+		reader.Read(&type, sizeof(type));
+
+		bool success = false;
+		switch (type) {
+			case INPUT_CAPTURE_RECORD_STRING: {
+				success = reader.ReadString(out_capture.strings.emplace_back());
+				break;
+			}
+
+			case INPUT_CAPTURE_RECORD_SAMPLE: {
+				InputCaptureSample& sample = out_capture.samples.emplace_back();
+				float pose[7];
+
+				success = reader.Read(&sample.action, sizeof(sample.action)) &&
+						  reader.Read(&sample.subaction_path, sizeof(sample.subaction_path)) &&
+						  reader.Read(&sample.interaction_profile, sizeof(sample.interaction_profile)) &&
+						  reader.Read(&sample.time, sizeof(sample.time)) &&
+						  reader.Read(&sample.location_flags, sizeof(sample.location_flags)) && reader.Read(pose, sizeof(pose));
+
+				sample.pose = {
+					.orientation = {.x = pose[3], .y = pose[4], .z = pose[5], .w = pose[6]},
+					.position = {.x = pose[0], .y = pose[1], .z = pose[2]},
+				};
+
+				// strings are always written before the first sample that uses them
+				const size_t string_count = out_capture.strings.size();
+				success = success && sample.action < string_count && sample.subaction_path < string_count &&
+						  sample.interaction_profile < string_count;
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		if (!success) {
+			XrpLog("Capture file %s is truncated or corrupt", file_name.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xr/xrp.h"
+
+// Binary capture of every pose sample, so the output can be regenerated without a headset.
+//
+// The file starts with the magic "CPTC", a version and the runtime name. It is followed by a stream of records, each starting with a
+// one byte type. String records define the next string id, and sample records refer to actions, subaction paths and interaction
+// profiles by string id. Everything is stored in the byte order of the machine that wrote it.
+
+static constexpr uint32_t input_capture_version = 1;
+
+struct InputCaptureSample {
+	uint32_t action;
+	uint32_t subaction_path;
+	uint32_t interaction_profile;
+
+	XrTime time;
+	XrSpaceLocationFlags location_flags;
+	// relative to the base pose's space if the action has one, otherwise the reference space
+	XrPosef pose;
+};
+
+struct InputCapture {
+	// as reported by the runtime, not resolved by the runtime matchers
+	std::string runtime_name;
+	std::vector<std::string> strings;
+	std::vector<InputCaptureSample> samples;
+};
+
+class InputCaptureWriter {
+   public:
+	bool Open(const std::string& file_name, const std::string& runtime_name);
+
+	// strings and paths are written to the file the first time they are used
+	uint32_t InternString(const std::string& string);
+	uint32_t InternPath(const XrpContext& context, XrPath path);
+
+	void WriteSample(const InputCaptureSample& sample);
+
+	// samples are buffered and only written to the file once enough have been collected, or when flushed
+	bool Flush();
+
+	~InputCaptureWriter();
+
+   private:
+	void Append(const void* data, size_t size);
+
+	FILE* file_ = nullptr;
+	std::vector<uint8_t> buffer_;
+
+	std::unordered_map<std::string, uint32_t> string_ids_;
+	std::unordered_map<XrPath, uint32_t> path_ids_;
+};
+
+// The whole file is read with a single read and decoded in place
+bool ReadInputCapture(const std::string& file_name, InputCapture& out_capture);
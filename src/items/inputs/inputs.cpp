@@ -6,26 +6,22 @@
 
 #include "inputs.h"
 
+#include <algorithm>
 #include <thread>
 #include <utility>
 
 #include "action_pose.h"
 #include "util/util_file.h"
 #include "xr/xrp.h"
+#include "xr/xrp_timing.h"
 
-template <typename... Args>
-std::string string_format(const std::string &format, Args... args) {
-	int size_s = std::snprintf(nullptr, 0, format.c_str(), args...) + 1;
-	if (size_s <= 0) {
-		throw std::runtime_error("Error during formatting.");
-	}
-	auto size = static_cast<size_t>(size_s);
-	std::unique_ptr<char[]> buf(new char[size]);
-	std::snprintf(buf.get(), size, format.c_str(), args...);
-	return {buf.get(), buf.get() + size - 1};
-}
+static const std::string eye_gaze_interaction_profile = "/interaction_profiles/ext/eye_gaze_interaction";
 
-InputItemSet::InputItemSet(pugi::xml_node inputs_config) { config_ = inputs_config; }
+InputItemSet::InputItemSet(pugi::xml_node inputs_config) {
+	config_ = inputs_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+	locate_velocities_ = config_.attribute("velocities").as_bool();
+}
 
 bool InputItemSet::GetRequiredExtensions(std::set<std::string> &out_extensions) {
 	// some interaction profiles require extensions
@@ -48,24 +44,19 @@ bool InputItemSet::GetRequiredExtensions(std::set<std::string> &out_extensions)
 		out_extensions.emplace(requires_extension_attribute.value());
 	}
 
+	if (!config_.select_nodes("./actions/action[@type='eye_gaze']").empty()) {
+		out_extensions.emplace(XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME);
+	}
+
 	return true;
 }
 
-bool InputItemSet::Init(const XrpContext &context) {
-	XrActionSetCreateInfo action_set_create_info = {
-		.type = XR_TYPE_ACTION_SET_CREATE_INFO,
-		.next = nullptr,
-		.actionSetName = "default",
-		.localizedActionSetName = "default",
-		.priority = 5,
-	};
-
-	XRP_CHECK_OR_RETURN(context, xrCreateActionSet(context.instance, &action_set_create_info, &action_set_));
-
+void InputItemSet::CreatePoses() {
 	for (const pugi::xpath_node &action_xpath_node : config_.select_nodes("./actions/action")) {
 		const pugi::xml_node action_node = action_xpath_node.node();
 
-		if (std::string(action_node.attribute("type").value()) == "pose") {
+		const std::string action_type = action_node.attribute("type").value();
+		if (action_type == "pose" || action_type == "eye_gaze") {
 			std::vector<std::string> subaction_paths{};
 			for (const pugi::xpath_node &subaction_node : action_node.select_nodes("./subaction_path")) {
 				subaction_paths.emplace_back(subaction_node.node().text().get());
@@ -74,7 +65,9 @@ bool InputItemSet::Init(const XrpContext &context) {
 			const std::string action_name = action_node.attribute("name").value();
 			const std::string suggested_binding = action_node.attribute("suggested_binding").value();
 			const std::string base = action_node.attribute("base").value();
-			const bool is_reference_pose = action_node.attribute("reference").as_bool();
+			const bool is_eye_gaze = action_type == "eye_gaze";
+			// the gaze is never still, so it's measured by the eye gaze item set rather than averaged into a canonical pose
+			const bool is_reference_pose = is_eye_gaze || action_node.attribute("reference").as_bool();
 
 			if (action_name.empty() || suggested_binding.empty()) {
 				XrpLog("Skipping action because action name or suggested binding was empty");
@@ -84,6 +77,7 @@ bool InputItemSet::Init(const XrpContext &context) {
 			PoseActionInfo pose_info = {
 				.name = action_name,
 				.reference = is_reference_pose,
+				.eye_gaze = is_eye_gaze,
 				.subaction_paths = subaction_paths,
 				.suggested_binding = suggested_binding,
 				.base = base,
@@ -94,14 +88,47 @@ bool InputItemSet::Init(const XrpContext &context) {
 			XrpLog("Unknown or unsupported action type");
 		}
 	}
+}
+
+bool InputItemSet::Init(XrpContext &context) {
+	XrpScopedPhase create_actions_phase("inputs: create actions");
+
+	XrActionSetCreateInfo action_set_create_info = {
+		.type = XR_TYPE_ACTION_SET_CREATE_INFO,
+		.next = nullptr,
+		.actionSetName = "default",
+		.localizedActionSetName = "default",
+		.priority = 5,
+	};
+
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrCreateActionSet(context.instance, &action_set_create_info, &action_set_));
+
+	CreatePoses();
+
+	const std::string capture_file = config_.attribute("capture_file").value();
+	if (!capture_file.empty()) {
+		capture_writer_ = std::make_unique<InputCaptureWriter>();
+		if (!capture_writer_->Open(GetOutputDirectory() + capture_file, context.instance_properties.runtimeName)) {
+			XrpLog("Samples will not be captured");
+			capture_writer_.reset();
+		}
+	}
 
 	std::vector<XrActionSuggestedBinding> suggested_bindings;
+	// eye gaze actions can only be bound in the eye gaze interaction profile, which can't bind anything else
+	std::vector<XrActionSuggestedBinding> eye_gaze_suggested_bindings;
 	for (const auto &pose : poses_) {
 		if (!pose.second->Init(context, action_set_, poses_[pose.second->GetActionInfo().base])) {
 			XrpLog("failed to create input");
 
 			return false;
 		}
+		pose.second->AppendActionSpaces(action_spaces_);
+
+		const PoseActionInfo action_info = pose.second->GetActionInfo();
+		for (const std::string &subaction : action_info.subaction_paths) {
+			context.action_spaces[subaction + action_info.suggested_binding] = pose.second->GetActionSpace(subaction);
+		}
 
 		std::vector<XrActionSuggestedBinding> action_suggested_bindings;
 		if (!pose.second->GetSuggestedBinding(context, action_suggested_bindings)) {
@@ -109,22 +136,34 @@ bool InputItemSet::Init(const XrpContext &context) {
 
 			continue;
 		}
-		suggested_bindings.insert(suggested_bindings.end(), action_suggested_bindings.begin(), action_suggested_bindings.end());
+
+		std::vector<XrActionSuggestedBinding> &profile_suggested_bindings = action_info.eye_gaze ? eye_gaze_suggested_bindings : suggested_bindings;
+		profile_suggested_bindings.insert(profile_suggested_bindings.end(), action_suggested_bindings.begin(), action_suggested_bindings.end());
 	}
 
+	create_actions_phase.End();
+
+	XrpScopedPhase suggest_bindings_phase("inputs: suggest bindings");
+
 	for (const pugi::xpath_node &interaction_profile_xpath_node : config_.select_nodes("./interaction_profiles/interaction_profile")) {
 		const std::string interaction_profile_string = interaction_profile_xpath_node.node().text().get();
 		XrPath interaction_profile_path = XrpStringToXrPath(context, interaction_profile_string);
 
+		const std::vector<XrActionSuggestedBinding> &profile_suggested_bindings =
+			interaction_profile_string == eye_gaze_interaction_profile ? eye_gaze_suggested_bindings : suggested_bindings;
+		if (profile_suggested_bindings.empty()) {
+			continue;
+		}
+
 		XrInteractionProfileSuggestedBinding suggested_bindings_info = {
 			.type = XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING,
 			.next = nullptr,
 			.interactionProfile = interaction_profile_path,
-			.countSuggestedBindings = static_cast<uint32_t>(suggested_bindings.size()),
-			.suggestedBindings = suggested_bindings.data(),
+			.countSuggestedBindings = static_cast<uint32_t>(profile_suggested_bindings.size()),
+			.suggestedBindings = profile_suggested_bindings.data(),
 		};
 
-		const XrResult result = xrSuggestInteractionProfileBindings(context.instance, &suggested_bindings_info);
+		const XrResult result = context.dispatch.xrSuggestInteractionProfileBindings(context.instance, &suggested_bindings_info);
 		if (result == XR_ERROR_PATH_UNSUPPORTED) {
 			XrpLog("Interaction profile: % path unsupported", interaction_profile_string.c_str());
 			continue;
@@ -135,39 +174,27 @@ bool InputItemSet::Init(const XrpContext &context) {
 		XrpLog("Set interaction profile for: %s", interaction_profile_string.c_str());
 	}
 
+	suggest_bindings_phase.End();
+
+	XrpScopedPhase attach_phase("inputs: attach action sets");
+
 	XrSessionActionSetsAttachInfo attach_info = {
 		.type = XR_TYPE_SESSION_ACTION_SETS_ATTACH_INFO,
 		.next = nullptr,
 		.countActionSets = 1,
 		.actionSets = &action_set_,
 	};
-	XRP_CHECK_OR_RETURN(context, xrAttachSessionActionSets(context.session, &attach_info));
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrAttachSessionActionSets(context.session, &attach_info));
 
 	return true;
 }
 
-static bool LoadReferenceXMLDocument(const XrpContext &context, const std::string &interaction_profile, pugi::xml_document &out_document) {
-	pugi::xml_document config;
-	GetConfigurationFile(config);
-
-	for (const pugi::xpath_node &runtime_input_xpath_node : config.select_nodes("//runtime/inputs/input")) {
-		const pugi::xml_node runtime_section_node = runtime_input_xpath_node.node();
-
-		if (runtime_section_node.attribute("interaction_profile").value() == interaction_profile) {
-			out_document.load_file(runtime_section_node.text().get());
-			return true;
-		}
+bool InputItemSet::Sample(const XrpContext &context, bool &out_complete) {
+	out_complete = sampled_frames_ >= sample_count_;
+	if (out_complete) {
+		return true;
 	}
 
-	return false;
-}
-
-static void MakeNode(pugi::xml_node &node, const std::string &node_name, const std::string &node_value) {
-	pugi::xml_node child_node = node.append_child(node_name.c_str());
-	child_node.append_child(pugi::node_pcdata).set_value(node_value.c_str());
-}
-
-bool InputItemSet::GetOutput(const XrpContext &context, ItemSetOutput &out_itemset) {
 	XrActiveActionSet active_action_set = {
 		.actionSet = action_set_,
 		.subactionPath = XR_NULL_PATH,
@@ -179,7 +206,64 @@ bool InputItemSet::GetOutput(const XrpContext &context, ItemSetOutput &out_items
 		.countActiveActionSets = 1,
 		.activeActionSets = &active_action_set,
 	};
-	XRP_CHECK_OR_RETURN(context, xrSyncActions(context.session, &sync_info));
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrSyncActions(context.session, &sync_info));
+
+	std::vector<XrSpaceVelocity> *space_velocities = locate_velocities_ ? &space_velocities_ : nullptr;
+	if (!XrpLocateSpaces(context, context.reference_space, context.current_frame_state.predictedDisplayTime, action_spaces_, space_locations_,
+						 space_velocities)) {
+		XrpLog("Failed to locate action spaces");
+		return false;
+	}
+
+	for (auto &pose : poses_) {
+		if (pose.first.empty()) continue;
+
+		if (!pose.second->Sample(context, space_locations_, space_velocities, capture_writer_.get())) {
+			XrpLog("Unable to sample pose: %s", pose.first.c_str());
+			return false;
+		}
+	}
+
+	sampled_frames_++;
+	out_complete = sampled_frames_ >= sample_count_;
+
+	return true;
+}
+
+// mean and standard deviation of each axis, and the distribution of the speed, over the frames the velocity was valid in
+static void MakeVelocityNode(pugi::xml_node &node, const char *node_name, const char *unit, const RunningStatistics (&axes)[3],
+							 const RunningStatistics &speed) {
+	pugi::xml_node velocity_node = node.append_child(node_name);
+	velocity_node.append_attribute("unit") = unit;
+	velocity_node.append_attribute("valid_frames") = speed.count;
+	if (speed.count == 0) {
+		return;
+	}
+
+	MakeNode(velocity_node, "X", static_cast<float>(axes[0].mean), 4);
+	MakeNode(velocity_node, "Y", static_cast<float>(axes[1].mean), 4);
+	MakeNode(velocity_node, "Z", static_cast<float>(axes[2].mean), 4);
+
+	if (speed.count > 1) {
+		pugi::xml_node standard_deviation_node = velocity_node.append_child("standard_deviation");
+		MakeNode(standard_deviation_node, "X", static_cast<float>(axes[0].StandardDeviation()), 4);
+		MakeNode(standard_deviation_node, "Y", static_cast<float>(axes[1].StandardDeviation()), 4);
+		MakeNode(standard_deviation_node, "Z", static_cast<float>(axes[2].StandardDeviation()), 4);
+	}
+
+	pugi::xml_node speed_node = velocity_node.append_child("speed");
+	MakeNode(speed_node, "mean", static_cast<float>(speed.mean), 4);
+	MakeNode(speed_node, "max", static_cast<float>(speed.max), 4);
+}
+
+bool InputItemSet::GetOutput(const XrpContext &context, ItemSetOutput &out_itemset) {
+	if (capture_writer_) {
+		capture_writer_->Flush();
+	}
+
+	if (!reference_poses_.IsLoaded() && !reference_poses_.Load()) {
+		XrpLog("Failed to load reference poses");
+	}
 
 	// map interaction profiles to files
 	std::map<std::string, ItemFile> interaction_profile_files;
@@ -215,66 +299,76 @@ bool InputItemSet::GetOutput(const XrpContext &context, ItemSetOutput &out_items
 			pose_node.append_attribute("name") = pose_info.action_name.c_str();
 			pose_node.append_attribute("base") = pose_info.base.c_str();
 			pose_node.append_attribute("binding_path") = pose_info.binding_path.c_str();
+			if (pose_info.sample_count > 1) {
+				pose_node.append_attribute("samples") = pose_info.sample_count;
+			}
 
-			pugi::xml_document reference_doc;
-			LoadReferenceXMLDocument(context, pose_info.interaction_profile, reference_doc);
-
-			const pugi::xml_node reference_pose_node =
-				reference_doc
-					.select_node(string_format("/inputs/pose[@name='%s' and @base='%s' and @binding_path='%s']", pose_info.action_name.c_str(),
-											   pose_info.base.c_str(), pose_info.binding_path.c_str())
-									 .c_str())
-					.node();
+			const ReferencePose *reference_pose = reference_poses_.Find({
+				.interaction_profile = pose_info.interaction_profile,
+				.name = pose_info.action_name,
+				.base = pose_info.base,
+				.binding_path = pose_info.binding_path,
+			});
 
-			if (reference_pose_node.empty()) {
+			if (!reference_pose) {
 				XrpLog("Could not find canonical pose: %s in reference file for interaction profile: %s", pose_info.action_name.c_str(),
 					   pose_info.interaction_profile.c_str());
 			}
 
 			{
 				pugi::xml_node position_node = pose_node.append_child("position");
-				const pugi::xml_node reference_position_node = reference_pose_node.child("position");
 
 				position_node.append_attribute("unit") = "meters";
 				if (pose_output_info.check_symmetrical) {
 					position_node.append_attribute("symmetrical") = pose_output_info.is_position_symmetrical;
 				}
 
-				if (!reference_pose_node.empty()) {
-					XrVector3f reference_position = {
-						.x = reference_position_node.child("X").text().as_float(),
-						.y = reference_position_node.child("Y").text().as_float(),
-						.z = reference_position_node.child("Z").text().as_float(),
-					};
-					position_node.append_attribute("matches_canonical") = reference_position == pose_info.pose.position;
+				if (reference_pose) {
+					position_node.append_attribute("matches_canonical") = reference_pose->position == pose_info.pose.position;
 				}
 
-				MakeNode(position_node, "X", XrpRoundFloatToString(pose_info.pose.position.x, 3));
-				MakeNode(position_node, "Y", XrpRoundFloatToString(pose_info.pose.position.y, 3));
-				MakeNode(position_node, "Z", XrpRoundFloatToString(pose_info.pose.position.z, 3));
+				MakeNode(position_node, "X", pose_info.pose.position.x, 3);
+				MakeNode(position_node, "Y", pose_info.pose.position.y, 3);
+				MakeNode(position_node, "Z", pose_info.pose.position.z, 3);
+
+				if (pose_info.sample_count > 1) {
+					pugi::xml_node standard_deviation_node = position_node.append_child("standard_deviation");
+					MakeNode(standard_deviation_node, "X", pose_info.position_standard_deviation.x, 4);
+					MakeNode(standard_deviation_node, "Y", pose_info.position_standard_deviation.y, 4);
+					MakeNode(standard_deviation_node, "Z", pose_info.position_standard_deviation.z, 4);
+				}
 			}
 			{
 				pugi::xml_node orientation_node = pose_node.append_child("orientation");
-				const pugi::xml_node reference_orientation_node = reference_pose_node.child("orientation");
 
 				if (pose_output_info.check_symmetrical) {
 					orientation_node.append_attribute("symmetrical") = pose_output_info.is_orientation_symmetrical;
 				}
 
-				if (!reference_pose_node.empty()) {
-					XrQuaternionf reference_orientation = {
-						.x = reference_orientation_node.child("X").text().as_float(),
-						.y = reference_orientation_node.child("Y").text().as_float(),
-						.z = reference_orientation_node.child("Z").text().as_float(),
-						.w = reference_orientation_node.child("W").text().as_float(),
-					};
-					orientation_node.append_attribute("matches_canonical") = reference_orientation == pose_info.pose.orientation;
+				if (reference_pose) {
+					orientation_node.append_attribute("matches_canonical") = reference_pose->orientation == pose_info.pose.orientation;
+				}
+
+				MakeNode(orientation_node, "W", pose_info.pose.orientation.w, 2);
+				MakeNode(orientation_node, "X", pose_info.pose.orientation.x, 2);
+				MakeNode(orientation_node, "Y", pose_info.pose.orientation.y, 2);
+				MakeNode(orientation_node, "Z", pose_info.pose.orientation.z, 2);
+
+				if (pose_info.sample_count > 1) {
+					pugi::xml_node standard_deviation_node = orientation_node.append_child("standard_deviation");
+					MakeNode(standard_deviation_node, "W", pose_info.orientation_standard_deviation.w, 4);
+					MakeNode(standard_deviation_node, "X", pose_info.orientation_standard_deviation.x, 4);
+					MakeNode(standard_deviation_node, "Y", pose_info.orientation_standard_deviation.y, 4);
+					MakeNode(standard_deviation_node, "Z", pose_info.orientation_standard_deviation.z, 4);
 				}
+			}
 
-				MakeNode(orientation_node, "W", XrpRoundFloatToString(pose_info.pose.orientation.w, 2));
-				MakeNode(orientation_node, "X", XrpRoundFloatToString(pose_info.pose.orientation.x, 2));
-				MakeNode(orientation_node, "Y", XrpRoundFloatToString(pose_info.pose.orientation.y, 2));
-				MakeNode(orientation_node, "Z", XrpRoundFloatToString(pose_info.pose.orientation.z, 2));
+			if (pose_info.velocity) {
+				pugi::xml_node velocity_node = pose_node.append_child("velocity");
+				velocity_node.append_attribute("frames") = pose_info.velocity->frames;
+
+				MakeVelocityNode(velocity_node, "linear", "meters_per_second", pose_info.velocity->linear, pose_info.velocity->linear_speed);
+				MakeVelocityNode(velocity_node, "angular", "radians_per_second", pose_info.velocity->angular, pose_info.velocity->angular_speed);
 			}
 		}
 	}
@@ -286,4 +380,50 @@ bool InputItemSet::GetOutput(const XrpContext &context, ItemSetOutput &out_items
 	return true;
 }
 
-InputItemSet::~InputItemSet() { xrDestroyActionSet(action_set_); }
\ No newline at end of file
+bool InputItemSet::Replay(const XrpContext &context, const InputCapture &capture) {
+	CreatePoses();
+
+	for (const auto &pose : poses_) {
+		if (pose.first.empty()) continue;
+
+		if (!pose.second->InitPaths(context, poses_[pose.second->GetActionInfo().base])) {
+			XrpLog("failed to create input");
+
+			return false;
+		}
+	}
+
+	// resolve every string in the capture once, so each sample is only a couple of array lookups
+	std::vector<PoseInput *> string_poses(capture.strings.size(), nullptr);
+	std::vector<XrPath> string_paths(capture.strings.size(), XR_NULL_PATH);
+	for (size_t i = 0; i < capture.strings.size(); i++) {
+		const auto pose = poses_.find(capture.strings[i]);
+		if (pose != poses_.end()) {
+			string_poses[i] = pose->second.get();
+		} else if (!capture.strings[i].empty() && capture.strings[i][0] == '/') {
+			string_paths[i] = XrpStringToXrPath(context, capture.strings[i]);
+		}
+	}
+
+	uint64_t skipped_samples = 0;
+	for (const InputCaptureSample &sample : capture.samples) {
+		PoseInput *pose = string_poses[sample.action];
+		if (!pose || !pose->ReplaySample(string_paths[sample.subaction_path], string_paths[sample.interaction_profile], sample.pose)) {
+			skipped_samples++;
+		}
+	}
+
+	if (skipped_samples > 0) {
+		XrpLog("Skipped %llu captured samples of actions that are not in the configuration", static_cast<unsigned long long>(skipped_samples));
+	}
+
+	sampled_frames_ = sample_count_;
+
+	return true;
+}
+
+InputItemSet::~InputItemSet() {
+	if (action_set_ != XR_NULL_HANDLE) {
+		xrDestroyActionSet(action_set_);
+	}
+}
\ No newline at end of file
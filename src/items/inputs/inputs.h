@@ -9,24 +9,48 @@
 #include <vector>
 
 #include "action_pose.h"
+#include "input_capture.h"
 #include "items/item.h"
 #include "pugixml.hpp"
-
+#include "reference_poses.h"
 
 class InputItemSet : public IItemSet {
    public:
 	explicit InputItemSet(pugi::xml_node inputs_config);
 
 	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
-	bool Init(const XrpContext& context) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
 	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
 
+	// Fills the pose statistics from a capture instead of sampling, so GetOutput can be called without an instance
+	bool Replay(const XrpContext& context, const InputCapture& capture);
+
 	~InputItemSet() override;
 
    private:
+	// creates a pose for every action in the configuration
+	void CreatePoses();
+
 	pugi::xml_node config_;
 
 	// <name, pose>
 	std::map<std::string, std::shared_ptr<PoseInput>> poses_;
 	XrActionSet action_set_{};
+
+	ReferencePoseDatabase reference_poses_;
+
+	// every pose's action spaces, located together each frame
+	std::vector<XrSpace> action_spaces_;
+	std::vector<XrSpaceLocation> space_locations_;
+	// only located when the configuration asks for velocities
+	bool locate_velocities_ = false;
+	std::vector<XrSpaceVelocity> space_velocities_;
+
+	// number of frames to sample each pose over
+	uint32_t sample_count_ = 1;
+	uint32_t sampled_frames_ = 0;
+
+	// only set when the configuration asks for the samples to be captured
+	std::unique_ptr<InputCaptureWriter> capture_writer_;
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "reference_poses.h"
+
+#include <set>
+
+#include "pugixml.hpp"
+#include "util/util_file.h"
+
+size_t ReferencePoseKeyHash::operator()(const ReferencePoseKey& key) const {
+	const std::hash<std::string> hasher;
+
+	size_t hash = hasher(key.interaction_profile);
+	for (const std::string* value : {&key.name, &key.base, &key.binding_path}) {
+		hash ^= hasher(*value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+
+	return hash;
+}
+
+bool ReferencePoseDatabase::Load() {
+	poses_.clear();
+	loaded_ = true;
+
+	std::shared_ptr<const pugi::xml_document> config;
+	if (!GetConfigurationFile(config)) {
+		XrpLog("Failed to load configuration for reference poses");
+		return false;
+	}
+
+	// only the first reference file listed for an interaction profile is used
+	std::set<std::string> loaded_interaction_profiles;
+
+	for (const pugi::xpath_node& runtime_input_xpath_node : config->select_nodes("//runtime/inputs/input")) {
+		const pugi::xml_node runtime_section_node = runtime_input_xpath_node.node();
+
+		const std::string interaction_profile = runtime_section_node.attribute("interaction_profile").value();
+		if (!loaded_interaction_profiles.insert(interaction_profile).second) {
+			continue;
+		}
+
+		pugi::xml_document reference_doc;
+		if (!reference_doc.load_file(runtime_section_node.text().get())) {
+			XrpLog("Failed to load reference file: %s", runtime_section_node.text().get());
+			continue;
+		}
+
+		for (const pugi::xpath_node& pose_xpath_node : reference_doc.select_nodes("/inputs/pose")) {
+			const pugi::xml_node pose_node = pose_xpath_node.node();
+			const pugi::xml_node position_node = pose_node.child("position");
+			const pugi::xml_node orientation_node = pose_node.child("orientation");
+
+			ReferencePoseKey key = {
+				.interaction_profile = interaction_profile,
+				.name = pose_node.attribute("name").value(),
+				.base = pose_node.attribute("base").value(),
+				.binding_path = pose_node.attribute("binding_path").value(),
+			};
+
+			ReferencePose reference_pose = {
+				.position =
+					{
+						.x = position_node.child("X").text().as_float(),
+						.y = position_node.child("Y").text().as_float(),
+						.z = position_node.child("Z").text().as_float(),
+					},
+				.orientation =
+					{
+						.x = orientation_node.child("X").text().as_float(),
+						.y = orientation_node.child("Y").text().as_float(),
+						.z = orientation_node.child("Z").text().as_float(),
+						.w = orientation_node.child("W").text().as_float(),
+					},
+			};
+
+			// keep the first pose if a file lists it twice, as the previous xpath lookup did
+			poses_.emplace(std::move(key), reference_pose);
+		}
+	}
+
+	return true;
+}
+
+bool ReferencePoseDatabase::IsLoaded() const { return loaded_; }
+
+const ReferencePose* ReferencePoseDatabase::Find(const ReferencePoseKey& key) const {
+	const auto reference_pose = poses_.find(key);
+	if (reference_pose == poses_.end()) {
+		return nullptr;
+	}
+
+	return &reference_pose->second;
+}
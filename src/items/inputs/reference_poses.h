@@ -0,0 +1,45 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "xr/xrp.h"
+
+struct ReferencePose {
+	XrVector3f position;
+	XrQuaternionf orientation;
+};
+
+struct ReferencePoseKey {
+	std::string interaction_profile;
+	std::string name;
+	std::string base;
+	std::string binding_path;
+
+	bool operator==(const ReferencePoseKey& other) const = default;
+};
+
+struct ReferencePoseKeyHash {
+	size_t operator()(const ReferencePoseKey& key) const;
+};
+
+// Canonical poses from every runtime reference file in the configuration, parsed once and indexed for lookup
+class ReferencePoseDatabase {
+   public:
+	bool Load();
+	bool IsLoaded() const;
+
+	// returns nullptr if there is no canonical pose for the key
+	const ReferencePose* Find(const ReferencePoseKey& key) const;
+
+   private:
+	bool loaded_ = false;
+
+	std::unordered_map<ReferencePoseKey, ReferencePose, ReferencePoseKeyHash> poses_;
+};
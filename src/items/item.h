@@ -23,11 +23,69 @@ struct ItemSetOutput {
 	std::vector<ItemFile> output_files;
 };
 
+static pugi::xml_node MakeNode(pugi::xml_node& node, const char* node_name, const char* node_value) {
+	pugi::xml_node child_node = node.append_child(node_name);
+	child_node.append_child(pugi::node_pcdata).set_value(node_value);
+
+	return child_node;
+}
+
+static pugi::xml_node MakeNode(pugi::xml_node& node, const char* node_name, float node_value, int precision) {
+	char buffer[XRP_FLOAT_STRING_SIZE];
+	XrpFormatFloat(node_value, precision, buffer, sizeof(buffer));
+
+	return MakeNode(node, node_name, buffer);
+}
+
+// position and orientation nodes of a mean pose, with their standard deviations if there was more than one sample
+static void MakePoseNodes(pugi::xml_node& node, const XrPosef& pose, uint64_t sample_count, const XrVector3f& position_standard_deviation,
+						  const XrQuaternionf& orientation_standard_deviation) {
+	{
+		pugi::xml_node position_node = node.append_child("position");
+		position_node.append_attribute("unit") = "meters";
+
+		MakeNode(position_node, "X", pose.position.x, 3);
+		MakeNode(position_node, "Y", pose.position.y, 3);
+		MakeNode(position_node, "Z", pose.position.z, 3);
+
+		if (sample_count > 1) {
+			pugi::xml_node standard_deviation_node = position_node.append_child("standard_deviation");
+			MakeNode(standard_deviation_node, "X", position_standard_deviation.x, 4);
+			MakeNode(standard_deviation_node, "Y", position_standard_deviation.y, 4);
+			MakeNode(standard_deviation_node, "Z", position_standard_deviation.z, 4);
+		}
+	}
+	{
+		pugi::xml_node orientation_node = node.append_child("orientation");
+
+		MakeNode(orientation_node, "W", pose.orientation.w, 2);
+		MakeNode(orientation_node, "X", pose.orientation.x, 2);
+		MakeNode(orientation_node, "Y", pose.orientation.y, 2);
+		MakeNode(orientation_node, "Z", pose.orientation.z, 2);
+
+		if (sample_count > 1) {
+			pugi::xml_node standard_deviation_node = orientation_node.append_child("standard_deviation");
+			MakeNode(standard_deviation_node, "W", orientation_standard_deviation.w, 4);
+			MakeNode(standard_deviation_node, "X", orientation_standard_deviation.x, 4);
+			MakeNode(standard_deviation_node, "Y", orientation_standard_deviation.y, 4);
+			MakeNode(standard_deviation_node, "Z", orientation_standard_deviation.z, 4);
+		}
+	}
+}
+
 class IItemSet {
    public:
 	virtual bool GetRequiredExtensions(std::set<std::string>& out_extensions) = 0;
-	virtual bool Init(const XrpContext& context) = 0;
+	// Called once the instance has been created. Item sets the runtime can't support (e.g. it lacks an extension they need) return
+	// false, and are skipped rather than failing the session for every other item set
+	virtual bool IsSupported(const XrpContext& context) { return true; }
+	// Called once the session is ready. Item sets can publish the action spaces they create in the context for other item sets
+	virtual bool Init(XrpContext& context) = 0;
+	// Called every focused frame until out_complete is set. GetOutput is only called once every item set has completed sampling.
+	virtual bool Sample(const XrpContext& context, bool& out_complete) = 0;
 	virtual bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) = 0;
+	// Called before the session is ended or destroyed. Item sets that use the session from other threads must stop them here.
+	virtual void OnSessionEnding() {}
 
 	virtual ~IItemSet() = default;
 };
\ No newline at end of file
@@ -0,0 +1,227 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "polling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+#include "xr/xrp.h"
+
+PollingItemSet::PollingItemSet(pugi::xml_node polling_config) {
+	config_ = polling_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+	rate_ = std::clamp(config_.attribute("rate_hz").as_double(1000.0), 1.0, 100000.0);
+}
+
+bool PollingItemSet::GetRequiredExtensions(std::set<std::string>& out_extensions) { return true; }
+
+bool PollingItemSet::IsSupported(const XrpContext& context) {
+	// the runtime's clock is what the poll times come from
+	XrTime now;
+	if (!XrpGetCurrentXrTime(context, now)) {
+		XrpLog("Polling requires the runtime's clock, which can't be read");
+		return false;
+	}
+
+	return true;
+}
+
+bool PollingItemSet::Init(XrpContext& context) {
+	queue_ = std::make_unique<SpscQueue<PollSample>>(std::max(config_.attribute("queue_capacity").as_uint(256), 1u));
+
+	return true;
+}
+
+bool PollingItemSet::Start(const XrpContext& context) {
+	if (context.action_spaces.empty()) {
+		XrpLog("Polling needs the inputs item set to create action spaces");
+		return false;
+	}
+
+	// the spaces are kept if polling is started again after the session ended
+	if (spaces_.empty()) {
+		const std::map<std::string, XrSpace> sorted_action_spaces(context.action_spaces.begin(), context.action_spaces.end());
+		for (const auto& action_space : sorted_action_spaces) {
+			if (spaces_.size() == poll_max_spaces) {
+				XrpLog("Only the first %u of %zu action spaces are polled", poll_max_spaces, sorted_action_spaces.size());
+				break;
+			}
+
+			binding_paths_.push_back(action_space.first);
+			spaces_.push_back(action_space.second);
+		}
+
+		statistics_.resize(spaces_.size());
+	}
+
+	polling_.store(true, std::memory_order_release);
+	thread_ = std::thread([this, &context] { Poll(context); });
+
+	return true;
+}
+
+void PollingItemSet::Stop() {
+	polling_.store(false, std::memory_order_release);
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+}
+
+void PollingItemSet::Poll(const XrpContext& context) {
+	const auto poll_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate_));
+
+	std::vector<XrSpaceLocation> locations(spaces_.size());
+
+	auto next_poll = std::chrono::steady_clock::now();
+	while (polling_.load(std::memory_order_acquire)) {
+		XrTime now;
+		if (!XrpGetCurrentXrTime(context, now) || !XrpLocateSpaces(context, context.reference_space, now, spaces_, locations)) {
+			failed_polls_.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			PollSample sample = {
+				.time = now,
+				.space_count = static_cast<uint32_t>(locations.size()),
+			};
+			for (size_t i = 0; i < locations.size(); i++) {
+				sample.location_flags[i] = locations[i].locationFlags;
+				sample.poses[i] = locations[i].pose;
+			}
+
+			if (!queue_->Push(sample)) {
+				dropped_polls_.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// if polling fell behind (e.g. the thread wasn't scheduled), carry on from now rather than polling in a burst to catch up
+		next_poll += poll_period;
+		const auto current_time = std::chrono::steady_clock::now();
+		if (next_poll < current_time) {
+			next_poll = current_time;
+		}
+
+		std::this_thread::sleep_until(next_poll);
+	}
+}
+
+void PollingItemSet::AddPoll(const PollSample& sample) {
+	if (poll_count_ > 0) {
+		poll_interval_.Add(static_cast<double>(sample.time - previous_poll_time_) / 1e3);
+	}
+
+	previous_poll_time_ = sample.time;
+	poll_count_++;
+
+	for (uint32_t i = 0; i < sample.space_count; i++) {
+		PollSpaceStatistics& statistics = statistics_[i];
+
+		if (!(sample.location_flags[i] & XR_SPACE_LOCATION_POSITION_VALID_BIT)) {
+			statistics.invalid_count++;
+			continue;
+		}
+
+		const XrVector3f& position = sample.poses[i].position;
+		if (statistics.position[0].count > 0) {
+			const XrVector3f offset = position - statistics.previous_position;
+			statistics.displacement.Add(std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z) * 1000.0);
+		}
+		statistics.previous_position = position;
+
+		statistics.position[0].Add(position.x * 1000.0);
+		statistics.position[1].Add(position.y * 1000.0);
+		statistics.position[2].Add(position.z * 1000.0);
+	}
+}
+
+bool PollingItemSet::Sample(const XrpContext& context, bool& out_complete) {
+	out_complete = poll_count_ >= sample_count_;
+	if (out_complete) {
+		return true;
+	}
+
+	if (!thread_.joinable() && !Start(context)) {
+		return false;
+	}
+
+	PollSample sample;
+	while (poll_count_ < sample_count_ && queue_->Pop(sample)) {
+		AddPoll(sample);
+	}
+
+	out_complete = poll_count_ >= sample_count_;
+	if (out_complete) {
+		Stop();
+	}
+
+	return true;
+}
+
+bool PollingItemSet::GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) {
+	Stop();
+
+	if (poll_count_ == 0) {
+		XrpLog("No samples were taken for polling.");
+		return false;
+	}
+
+	ItemFile item_file = {
+		.name = "polling",
+	};
+
+	pugi::xml_node polling_node = item_file.document.append_child("polling");
+	polling_node.append_attribute("polls") = poll_count_;
+	polling_node.append_attribute("dropped_polls") = dropped_polls_.load(std::memory_order_relaxed);
+	polling_node.append_attribute("failed_polls") = failed_polls_.load(std::memory_order_relaxed);
+
+	MakeNode(polling_node, "rate", static_cast<float>(rate_), 1).append_attribute("unit") = "hz";
+
+	{
+		pugi::xml_node interval_node = polling_node.append_child("interval");
+		interval_node.append_attribute("unit") = "microseconds";
+		MakeNode(interval_node, "mean", static_cast<float>(poll_interval_.mean), 1);
+		MakeNode(interval_node, "standard_deviation", static_cast<float>(poll_interval_.StandardDeviation()), 1);
+		MakeNode(interval_node, "min", static_cast<float>(poll_interval_.min), 1);
+		MakeNode(interval_node, "max", static_cast<float>(poll_interval_.max), 1);
+	}
+
+	for (size_t i = 0; i < spaces_.size(); i++) {
+		const PollSpaceStatistics& statistics = statistics_[i];
+
+		pugi::xml_node space_node = polling_node.append_child("space");
+		space_node.append_attribute("binding_path") = binding_paths_[i].c_str();
+		space_node.append_attribute("samples") = statistics.position[0].count;
+		if (statistics.invalid_count > 0) {
+			space_node.append_attribute("invalid") = statistics.invalid_count;
+		}
+
+		if (statistics.position[0].count < 2) {
+			continue;
+		}
+
+		pugi::xml_node position_node = space_node.append_child("position_standard_deviation");
+		position_node.append_attribute("unit") = "millimeters";
+		MakeNode(position_node, "X", static_cast<float>(statistics.position[0].StandardDeviation()), 4);
+		MakeNode(position_node, "Y", static_cast<float>(statistics.position[1].StandardDeviation()), 4);
+		MakeNode(position_node, "Z", static_cast<float>(statistics.position[2].StandardDeviation()), 4);
+
+		pugi::xml_node displacement_node = space_node.append_child("displacement");
+		displacement_node.append_attribute("unit") = "millimeters";
+		MakeNode(displacement_node, "mean", static_cast<float>(statistics.displacement.mean), 4);
+		MakeNode(displacement_node, "standard_deviation", static_cast<float>(statistics.displacement.StandardDeviation()), 4);
+		MakeNode(displacement_node, "max", static_cast<float>(statistics.displacement.max), 4);
+	}
+
+	out_itemset.output_files.emplace_back(std::move(item_file));
+
+	return true;
+}
+
+// the polling thread locates spaces of the session, so it must stop before the session is ended or destroyed
+void PollingItemSet::OnSessionEnding() { Stop(); }
+
+PollingItemSet::~PollingItemSet() { Stop(); }
@@ -0,0 +1,100 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "items/item.h"
+#include "pugixml.hpp"
+#include "util/util_spsc_queue.h"
+#include "util/util_statistics.h"
+
+// at most this many action spaces are polled, so a poll fits in a fixed size queue entry
+static constexpr uint32_t poll_max_spaces = 32;
+
+// Every action space located by one poll of the polling thread
+struct PollSample {
+	XrTime time;
+	uint32_t space_count;
+	// indexed the same as the item set's spaces
+	std::array<XrSpaceLocationFlags, poll_max_spaces> location_flags;
+	std::array<XrPosef, poll_max_spaces> poses;
+};
+
+// Jitter of one action space between consecutive polls
+struct PollSpaceStatistics {
+	// X, Y, Z, in millimeters
+	RunningStatistics position[3];
+	// millimeters moved since the previous valid poll
+	RunningStatistics displacement;
+
+	XrVector3f previous_position = {};
+	// polls where the space wasn't located
+	uint64_t invalid_count = 0;
+};
+
+// Locates every action space the inputs item set created from a thread of its own, at a fixed rate rather than once per display
+// frame, for much denser data on tracking jitter. Poll times are the runtime's current time, converted from the system's
+// monotonic clock. Polls are passed to the frame thread through a single-producer, single-consumer queue, and accumulated there.
+class PollingItemSet : public IItemSet {
+   public:
+	explicit PollingItemSet(pugi::xml_node polling_config);
+
+	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
+	bool IsSupported(const XrpContext& context) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
+	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
+	void OnSessionEnding() override;
+
+	~PollingItemSet() override;
+
+   private:
+	// picks up the action spaces once the inputs item set has created them, and starts polling them
+	bool Start(const XrpContext& context);
+	void Stop();
+
+	// polling thread
+	void Poll(const XrpContext& context);
+
+	void AddPoll(const PollSample& sample);
+
+	pugi::xml_node config_;
+
+	// binding path (e.g. /user/hand/left/input/grip/pose) and space of every action space, sorted by binding path
+	std::vector<std::string> binding_paths_;
+	std::vector<XrSpace> spaces_;
+
+	// frames drain the queue, so it only needs to hold a few frames' worth of polls
+	std::unique_ptr<SpscQueue<PollSample>> queue_;
+
+	std::thread thread_;
+	std::atomic<bool> polling_{false};
+	// polls that didn't fit in the queue, and polls where the spaces couldn't be located
+	std::atomic<uint64_t> dropped_polls_{0};
+	std::atomic<uint64_t> failed_polls_{0};
+
+	// everything below is only used by the frame thread
+
+	std::vector<PollSpaceStatistics> statistics_;
+
+	// microseconds between consecutive polls
+	RunningStatistics poll_interval_;
+	XrTime previous_poll_time_ = 0;
+	uint64_t poll_count_ = 0;
+
+	// polls per second
+	double rate_ = 1000.0;
+
+	// number of polls to collect
+	uint32_t sample_count_ = 1;
+};
@@ -0,0 +1,170 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "prediction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numbers>
+
+#include "xr/xrp.h"
+
+PredictionItemSet::PredictionItemSet(pugi::xml_node prediction_config) {
+	config_ = prediction_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+	delay_frames_ = std::max(config_.attribute("delay_frames").as_uint(5), 1u);
+}
+
+bool PredictionItemSet::GetRequiredExtensions(std::set<std::string>& out_extensions) { return true; }
+
+bool PredictionItemSet::Init(XrpContext& context) {
+	frames_.resize(delay_frames_ + 1);
+
+	return true;
+}
+
+bool PredictionItemSet::InitSpaces(const XrpContext& context) {
+	if (context.action_spaces.empty()) {
+		XrpLog("Prediction error needs the inputs item set to create action spaces");
+		return false;
+	}
+
+	const std::map<std::string, XrSpace> sorted_action_spaces(context.action_spaces.begin(), context.action_spaces.end());
+	for (const auto& action_space : sorted_action_spaces) {
+		binding_paths_.push_back(action_space.first);
+		spaces_.push_back(action_space.second);
+	}
+
+	// allocate everything up front, so sampling doesn't allocate
+	for (PredictionFrame& frame : frames_) {
+		frame.predicted_locations.resize(spaces_.size());
+	}
+	late_locations_.resize(spaces_.size());
+
+	statistics_.resize(spaces_.size());
+	for (PredictionErrorStatistics& statistics : statistics_) {
+		statistics.position_errors.reserve(sample_count_);
+		statistics.angle_errors.reserve(sample_count_);
+	}
+
+	return true;
+}
+
+bool PredictionItemSet::Sample(const XrpContext& context, bool& out_complete) {
+	out_complete = sampled_frames_ >= sample_count_;
+	if (out_complete) {
+		return true;
+	}
+
+	if (spaces_.empty() && !InitSpaces(context)) {
+		return false;
+	}
+
+	PredictionFrame& frame = frames_[frame_count_ % frames_.size()];
+	frame.time = context.current_frame_state.predictedDisplayTime;
+	if (!XrpLocateSpaces(context, context.reference_space, frame.time, spaces_, frame.predicted_locations)) {
+		XrpLog("Failed to locate action spaces at the predicted display time");
+		return false;
+	}
+	frame_count_++;
+
+	if (frame_count_ <= delay_frames_) {
+		return true;
+	}
+
+	// the slot after the one just written is the oldest in the ring, delay_frames_ frames ago
+	const PredictionFrame& delayed_frame = frames_[frame_count_ % frames_.size()];
+	if (!XrpLocateSpaces(context, context.reference_space, delayed_frame.time, spaces_, late_locations_)) {
+		XrpLog("Failed to locate action spaces at a previous display time");
+		return false;
+	}
+
+	const XrSpaceLocationFlags required_flags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT;
+	for (size_t i = 0; i < spaces_.size(); i++) {
+		const XrSpaceLocation& predicted = delayed_frame.predicted_locations[i];
+		const XrSpaceLocation& late = late_locations_[i];
+		PredictionErrorStatistics& statistics = statistics_[i];
+
+		if ((predicted.locationFlags & required_flags) != required_flags || (late.locationFlags & required_flags) != required_flags) {
+			statistics.invalid_count++;
+			continue;
+		}
+
+		const XrVector3f offset = late.pose.position - predicted.pose.position;
+		const float position_error = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z) * 1000.f;
+
+		// angle of the rotation between the two orientations. q and -q are the same rotation, so only the magnitude of the dot matters
+		const XrQuaternionf& q1 = predicted.pose.orientation;
+		const XrQuaternionf& q2 = late.pose.orientation;
+		const float dot = std::min(std::fabs(q1.w * q2.w + q1.x * q2.x + q1.y * q2.y + q1.z * q2.z), 1.f);
+		const float angle_error = 2.f * std::acos(dot) * static_cast<float>(180.0 / std::numbers::pi);
+
+		statistics.position.Add(position_error);
+		statistics.angle.Add(angle_error);
+		statistics.position_errors.push_back(position_error);
+		statistics.angle_errors.push_back(angle_error);
+	}
+
+	sampled_frames_++;
+	out_complete = sampled_frames_ >= sample_count_;
+
+	return true;
+}
+
+static void MakeErrorNode(pugi::xml_node& node, const char* node_name, const char* unit, const RunningStatistics& statistics,
+						  std::vector<float>& errors) {
+	pugi::xml_node error_node = node.append_child(node_name);
+	error_node.append_attribute("unit") = unit;
+
+	MakeNode(error_node, "mean", static_cast<float>(statistics.mean), 3);
+	MakeNode(error_node, "standard_deviation", static_cast<float>(statistics.StandardDeviation()), 3);
+
+	std::sort(errors.begin(), errors.end());
+	for (const uint32_t percentile : {50u, 95u, 99u}) {
+		const std::string name = "p" + std::to_string(percentile);
+		MakeNode(error_node, name.c_str(), SortedPercentile(errors, percentile), 3);
+	}
+
+	MakeNode(error_node, "max", static_cast<float>(statistics.max), 3);
+}
+
+bool PredictionItemSet::GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) {
+	if (sampled_frames_ == 0) {
+		XrpLog("No samples were taken for the prediction error.");
+		return false;
+	}
+
+	ItemFile item_file = {
+		.name = "prediction",
+	};
+
+	pugi::xml_node prediction_node = item_file.document.append_child("prediction");
+	prediction_node.append_attribute("samples") = sampled_frames_;
+	prediction_node.append_attribute("delay_frames") = delay_frames_;
+
+	for (size_t i = 0; i < spaces_.size(); i++) {
+		PredictionErrorStatistics& statistics = statistics_[i];
+
+		pugi::xml_node space_node = prediction_node.append_child("space");
+		space_node.append_attribute("binding_path") = binding_paths_[i].c_str();
+		space_node.append_attribute("samples") = statistics.position.count;
+		if (statistics.invalid_count > 0) {
+			space_node.append_attribute("invalid") = statistics.invalid_count;
+		}
+
+		if (statistics.position.count == 0) {
+			continue;
+		}
+
+		MakeErrorNode(space_node, "position_error", "millimeters", statistics.position, statistics.position_errors);
+		MakeErrorNode(space_node, "angular_error", "degrees", statistics.angle, statistics.angle_errors);
+	}
+
+	out_itemset.output_files.emplace_back(std::move(item_file));
+
+	return true;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "items/item.h"
+#include "pugixml.hpp"
+#include "util/util_statistics.h"
+
+// Every action space located at the predicted display time of one frame
+struct PredictionFrame {
+	XrTime time = 0;
+	// indexed the same as the item set's spaces
+	std::vector<XrSpaceLocation> predicted_locations;
+};
+
+// Differences between where a space was predicted to be and where the runtime later located it at the same time
+struct PredictionErrorStatistics {
+	// millimeters
+	RunningStatistics position;
+	// degrees
+	RunningStatistics angle;
+
+	// every error, kept for the percentiles. Reserved up front for the number of samples
+	std::vector<float> position_errors;
+	std::vector<float> angle_errors;
+
+	// measurements where either location wasn't valid
+	uint64_t invalid_count = 0;
+};
+
+// Measures the runtime's pose prediction error without external tracking. Every action space the inputs item set created is located
+// at the predicted display time of each frame, and located again at that same time a number of frames later, by when the runtime
+// has tracking data for it. Located frames are kept in a ring buffer, one slot per frame of delay.
+class PredictionItemSet : public IItemSet {
+   public:
+	explicit PredictionItemSet(pugi::xml_node prediction_config);
+
+	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
+	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
+
+   private:
+	// picks up the action spaces once the inputs item set has created them
+	bool InitSpaces(const XrpContext& context);
+
+	pugi::xml_node config_;
+
+	// binding path (e.g. /user/hand/left/input/grip/pose) and space of every action space, sorted by binding path
+	std::vector<std::string> binding_paths_;
+	std::vector<XrSpace> spaces_;
+
+	std::vector<PredictionFrame> frames_;
+	// number of frames located at their predicted display time
+	uint64_t frame_count_ = 0;
+
+	// locations at the time of a previous frame are located here before being compared
+	std::vector<XrSpaceLocation> late_locations_;
+
+	// indexed the same as spaces_
+	std::vector<PredictionErrorStatistics> statistics_;
+
+	// frames between locating a time as a prediction and locating it again
+	uint32_t delay_frames_ = 5;
+
+	// number of frames to measure the prediction error over
+	uint32_t sample_count_ = 1;
+	uint32_t sampled_frames_ = 0;
+};
@@ -0,0 +1,195 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "views.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "xr/xrp.h"
+
+void ViewFrame::Load(const XrView* views) {
+	poses.Load(views);
+
+	for (size_t i = 0; i < view_count; i++) {
+		fov[0][i] = views[i].fov.angleLeft;
+		fov[1][i] = views[i].fov.angleRight;
+		fov[2][i] = views[i].fov.angleUp;
+		fov[3][i] = views[i].fov.angleDown;
+	}
+}
+
+void ViewStatistics::Add(const ViewFrame& frame) {
+	poses.Add(frame.poses);
+
+	const double inverse_count = 1.0 / static_cast<double>(poses.count);
+	for (size_t component = 0; component < 4; component++) {
+		JointWelfordAdd(fov_mean[component], fov_m2[component], frame.fov[component], inverse_count);
+	}
+}
+
+XrFovf ViewStatistics::GetMeanFov(size_t view) const {
+	return {
+		.angleLeft = static_cast<float>(fov_mean[0][view]),
+		.angleRight = static_cast<float>(fov_mean[1][view]),
+		.angleUp = static_cast<float>(fov_mean[2][view]),
+		.angleDown = static_cast<float>(fov_mean[3][view]),
+	};
+}
+
+XrFovf ViewStatistics::GetFovStandardDeviation(size_t view) const {
+	return {
+		.angleLeft = JointStandardDeviation(fov_m2[0][view], poses.count),
+		.angleRight = JointStandardDeviation(fov_m2[1][view], poses.count),
+		.angleUp = JointStandardDeviation(fov_m2[2][view], poses.count),
+		.angleDown = JointStandardDeviation(fov_m2[3][view], poses.count),
+	};
+}
+
+static const char* GetViewName(size_t view) {
+	static const char* const names[view_count] = {
+		"left",
+		"right",
+	};
+
+	return view < view_count ? names[view] : "unknown";
+}
+
+ViewItemSet::ViewItemSet(pugi::xml_node views_config) {
+	config_ = views_config;
+	sample_count_ = std::max(config_.attribute("samples").as_uint(1), 1u);
+
+	for (XrView& view : views_) {
+		view = {
+			.type = XR_TYPE_VIEW,
+			.next = nullptr,
+		};
+	}
+}
+
+bool ViewItemSet::GetRequiredExtensions(std::set<std::string>& out_extensions) { return true; }
+
+bool ViewItemSet::Init(XrpContext& context) {
+	XrReferenceSpaceCreateInfo reference_space_create_info = {
+		.type = XR_TYPE_REFERENCE_SPACE_CREATE_INFO,
+		.next = nullptr,
+		.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW,
+		.poseInReferenceSpace = xrp_identity_pose,
+	};
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrCreateReferenceSpace(context.session, &reference_space_create_info, &view_space_));
+
+	return true;
+}
+
+bool ViewItemSet::Sample(const XrpContext& context, bool& out_complete) {
+	out_complete = statistics_.GetSampleCount() >= sample_count_;
+	if (out_complete) {
+		return true;
+	}
+
+	XrViewLocateInfo view_locate_info = {
+		.type = XR_TYPE_VIEW_LOCATE_INFO,
+		.next = nullptr,
+		.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+		.displayTime = context.current_frame_state.predictedDisplayTime,
+		.space = view_space_,
+	};
+	XrViewState view_state = {
+		.type = XR_TYPE_VIEW_STATE,
+		.next = nullptr,
+	};
+	uint32_t located_view_count = 0;
+	XRP_CHECK_OR_RETURN(context,
+						context.dispatch.xrLocateViews(context.session, &view_locate_info, &view_state, view_count, &located_view_count, views_));
+
+	const XrViewStateFlags required_flags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT;
+	if (located_view_count != view_count || (view_state.viewStateFlags & required_flags) != required_flags) {
+		rejected_frames_++;
+		return true;
+	}
+
+	frame_.Load(views_);
+	statistics_.Add(frame_);
+
+	const XrVector3f eye_offset = views_[1].pose.position - views_[0].pose.position;
+	ipd_.Add(std::sqrt(eye_offset.x * eye_offset.x + eye_offset.y * eye_offset.y + eye_offset.z * eye_offset.z));
+
+	out_complete = statistics_.GetSampleCount() >= sample_count_;
+
+	return true;
+}
+
+static void MakeAngleNode(pugi::xml_node& node, const char* node_name, float mean, float standard_deviation, bool has_standard_deviation) {
+	constexpr float degrees_per_radian = static_cast<float>(180.0 / std::numbers::pi);
+
+	pugi::xml_node angle_node = MakeNode(node, node_name, mean * degrees_per_radian, 3);
+	if (has_standard_deviation) {
+		char buffer[XRP_FLOAT_STRING_SIZE];
+		XrpFormatFloat(standard_deviation * degrees_per_radian, 4, buffer, sizeof(buffer));
+		angle_node.append_attribute("standard_deviation") = buffer;
+	}
+}
+
+bool ViewItemSet::GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) {
+	const uint64_t sample_count = statistics_.GetSampleCount();
+	if (sample_count == 0) {
+		XrpLog("No samples were taken for the views.");
+		return false;
+	}
+
+	ItemFile item_file = {
+		.name = "views",
+	};
+
+	pugi::xml_node views_node = item_file.document.append_child("views");
+	views_node.append_attribute("view_configuration") = "primary_stereo";
+	if (sample_count > 1) {
+		views_node.append_attribute("samples") = sample_count;
+	}
+	if (rejected_frames_ > 0) {
+		views_node.append_attribute("rejected_frames") = rejected_frames_;
+	}
+
+	{
+		pugi::xml_node ipd_node = views_node.append_child("ipd");
+		ipd_node.append_attribute("unit") = "meters";
+		MakeNode(ipd_node, "mean", static_cast<float>(ipd_.mean), 4);
+		if (sample_count > 1) {
+			MakeNode(ipd_node, "standard_deviation", static_cast<float>(ipd_.StandardDeviation()), 5);
+			MakeNode(ipd_node, "min", static_cast<float>(ipd_.min), 4);
+			MakeNode(ipd_node, "max", static_cast<float>(ipd_.max), 4);
+		}
+	}
+
+	for (size_t i = 0; i < view_count; i++) {
+		pugi::xml_node view_node = views_node.append_child("view");
+		view_node.append_attribute("name") = GetViewName(i);
+
+		MakePoseNodes(view_node, statistics_.poses.GetMeanPose(i), sample_count, statistics_.poses.GetPositionStandardDeviation(i),
+					  statistics_.poses.GetOrientationStandardDeviation(i));
+
+		const XrFovf fov = statistics_.GetMeanFov(i);
+		const XrFovf fov_standard_deviation = statistics_.GetFovStandardDeviation(i);
+
+		pugi::xml_node fov_node = view_node.append_child("fov");
+		fov_node.append_attribute("unit") = "degrees";
+		MakeAngleNode(fov_node, "left", fov.angleLeft, fov_standard_deviation.angleLeft, sample_count > 1);
+		MakeAngleNode(fov_node, "right", fov.angleRight, fov_standard_deviation.angleRight, sample_count > 1);
+		MakeAngleNode(fov_node, "up", fov.angleUp, fov_standard_deviation.angleUp, sample_count > 1);
+		MakeAngleNode(fov_node, "down", fov.angleDown, fov_standard_deviation.angleDown, sample_count > 1);
+	}
+
+	out_itemset.output_files.emplace_back(std::move(item_file));
+
+	return true;
+}
+
+ViewItemSet::~ViewItemSet() {
+	if (view_space_ != XR_NULL_HANDLE) {
+		xrDestroySpace(view_space_);
+	}
+}
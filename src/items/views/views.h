@@ -0,0 +1,76 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <string>
+
+#include "items/item.h"
+#include "pugixml.hpp"
+#include "util/util_joint_statistics.h"
+#include "util/util_statistics.h"
+
+// XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO has a left and a right view
+static constexpr size_t view_count = 2;
+
+// Both views located in one frame, in the structure of arrays layout of JointPoseFrame
+struct ViewFrame {
+	JointPoseFrame<view_count> poses;
+	// left, right, up, down, in radians
+	float fov[4][view_count];
+
+	// transposes the views returned by xrLocateViews
+	void Load(const XrView* views);
+};
+
+// Both views are located together, so they share one sample count
+struct ViewStatistics {
+	JointPoseStatistics<view_count> poses;
+
+	double fov_mean[4][view_count] = {};
+	double fov_m2[4][view_count] = {};
+
+	void Add(const ViewFrame& frame);
+
+	uint64_t GetSampleCount() const { return poses.count; }
+	XrFovf GetMeanFov(size_t view) const;
+	XrFovf GetFovStandardDeviation(size_t view) const;
+};
+
+// Locates the views of the primary stereo view configuration every frame, relative to the view reference space, to capture the
+// canonical eye poses, field of view and IPD of the headset along with the controllers. Everything is accumulated into fixed size
+// arrays, so sampling doesn't allocate.
+class ViewItemSet : public IItemSet {
+   public:
+	explicit ViewItemSet(pugi::xml_node views_config);
+
+	bool GetRequiredExtensions(std::set<std::string>& out_extensions) override;
+	bool Init(XrpContext& context) override;
+	bool Sample(const XrpContext& context, bool& out_complete) override;
+	bool GetOutput(const XrpContext& context, ItemSetOutput& out_itemset) override;
+
+	~ViewItemSet() override;
+
+   private:
+	pugi::xml_node config_;
+
+	// views are located relative to the head, so the poses don't depend on where the headset is
+	XrSpace view_space_ = XR_NULL_HANDLE;
+
+	// xrLocateViews writes here, before the views are transposed into frame_
+	XrView views_[view_count];
+	ViewFrame frame_;
+
+	ViewStatistics statistics_;
+	// meters between the positions of the left and right views
+	RunningStatistics ipd_;
+
+	// frames where the views couldn't be located
+	uint64_t rejected_frames_ = 0;
+
+	// number of frames to sample the views over
+	uint32_t sample_count_ = 1;
+};
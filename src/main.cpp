@@ -4,12 +4,14 @@
 //
 // Initial Author: Daniel Willmott <danw@valvesoftware.com>
 
+#include <algorithm>
 #include <memory>
-#include <regex>
 
 #include "pugixml.hpp"
 #include "util/util_file.h"
+#include "util/util_runtime.h"
 #include "xr/xrp.h"
+#include "xr/xrp_timing.h"
 
 #define CNFG_IMPLEMENTATION
 #define CNFGOGL
@@ -22,58 +24,78 @@ void HandleDestroy() {}
 void HandleResume() {}
 void HandleSuspend() {}
 
+#include "items/body/body.h"
+#include "items/eye_gaze/eye_gaze.h"
+#include "items/face/face.h"
+#include "items/hands/hands.h"
 #include "items/inputs/inputs.h"
+#include "items/polling/polling.h"
+#include "items/prediction/prediction.h"
+#include "items/views/views.h"
 
-static void SaveItemSetXML(const XrpContext& context, ItemSetOutput& item_set_output) {
-	pugi::xml_document config;
-	GetConfigurationFile(config);
+static std::string GetBaseOutputFileName(const std::string& runtime_name) { return GetOutputDirectory() + "cpt_" + runtime_name; }
 
-	std::string runtime_name = context.instance_properties.runtimeName;
-	for (const auto& runtime_xpath_node : config.select_nodes("//runtime")) {
-		pugi::xml_node runtime_node = runtime_xpath_node.node();
+static void SaveItemSetXML(const std::string& runtime_name, ItemSetOutput& item_set_output) {
+	const std::string base_file_name = GetBaseOutputFileName(runtime_name);
 
-		const std::string matches = runtime_node.attribute("matches").value();
-		const std::string name = runtime_node.attribute("name").value();
-		if (matches.empty() || name.empty()) {
-			continue;
-		}
-
-		std::regex runtime_match_regex(matches);
-		if (std::regex_match(context.instance_properties.runtimeName, runtime_match_regex)) {
-			runtime_name = name;
+	for (ItemFile& item_file : item_set_output.output_files) {
+		const std::string file_name = base_file_name + "-" + item_file.name + ".xml";
 
-			break;
+		if (!item_file.document.save_file(file_name.c_str())) {
+			XrpLog("failed to save file: %s", file_name.c_str());
+			continue;
 		}
 	}
+}
 
-	std::string base_path;
-#ifdef XR_USE_PLATFORM_ANDROID
-	base_path = AndroidGetDataPath() + "/";
-#endif
+struct EnabledItemSet {
+	std::string name;
+	std::unique_ptr<IItemSet> item_set;
 
-	std::string base_file_name = base_path + "cpt_" + runtime_name;
+	// trace events keep a view of their name, so these need to outlive writing the trace
+	std::string init_trace_name;
+	std::string sample_trace_name;
+	std::string output_trace_name;
+};
 
-	for (ItemFile& item_file : item_set_output.output_files) {
-		const std::string file_name = base_file_name + "-" + item_file.name + ".xml";
+// Every item set is sampled every frame, even if an earlier one fails, as item sets can depend on each other (e.g. inputs syncs the
+// actions other item sets locate relative to)
+static bool SampleItemSets(const std::vector<EnabledItemSet>& item_sets, const XrpContext& context) {
+	bool all_complete = true;
+	for (const auto& item_set : item_sets) {
+		bool complete = false;
 
-		if (!item_file.document.save_file(file_name.c_str())) {
-			XrpLog("failed to save file: %s", file_name.c_str());
-			continue;
+		XrpTraceScope trace_scope(item_set.sample_trace_name);
+		if (!item_set.item_set->Sample(context, complete)) {
+			XrpLog("failed to sample item set: %s, retrying next frame", item_set.name.c_str());
+			complete = false;
 		}
+
+		all_complete = all_complete && complete;
 	}
+
+	return all_complete;
 }
 
-void MakeFile(const std::vector<std::unique_ptr<IItemSet>>& item_sets, const XrpContext& context) {
+void MakeFile(const std::vector<EnabledItemSet>& item_sets, const XrpContext& context, const std::string& runtime_name) {
+	// Only recorded once the output is written, as every frame until then retries
+	const auto start = std::chrono::steady_clock::now();
+
 	for (const auto& item_set : item_sets) {
 		ItemSetOutput item_set_output;
-		if (!item_set->GetOutput(context, item_set_output)) {
-			XrpLog("failed to get item set, retrying next frame");
+
+		XrpTraceScope trace_scope(item_set.output_trace_name);
+		if (!item_set.item_set->GetOutput(context, item_set_output)) {
+			XrpLog("failed to get item set: %s, retrying next frame", item_set.name.c_str());
 			return;
 		};
 
-		SaveItemSetXML(context, item_set_output);
+		SaveItemSetXML(runtime_name, item_set_output);
 	}
 
+	XrpRecordPhase("MakeFile", start, std::chrono::steady_clock::now());
+	XrpRecordMilestone("output written");
+
 	// Exit the session as we're done
 	XrpRequestExitSession(context);
 }
@@ -81,16 +103,59 @@ void MakeFile(const std::vector<std::unique_ptr<IItemSet>>& item_sets, const Xrp
 static std::map<std::string, std::unique_ptr<IItemSet>> GetAllItemSets(const pugi::xml_node& config_node) {
 	std::map<std::string, std::unique_ptr<IItemSet>> item_sets;
 	item_sets["inputs"] = std::make_unique<InputItemSet>(config_node.child("inputs"));
+	item_sets["hands"] = std::make_unique<HandItemSet>(config_node.child("hands"));
+	item_sets["body"] = std::make_unique<BodyItemSet>(config_node.child("body"));
+	item_sets["face"] = std::make_unique<FaceItemSet>(config_node.child("face"));
+	item_sets["eye_gaze"] = std::make_unique<EyeGazeItemSet>(config_node.child("eye_gaze"));
+	item_sets["views"] = std::make_unique<ViewItemSet>(config_node.child("views"));
+	item_sets["prediction"] = std::make_unique<PredictionItemSet>(config_node.child("prediction"));
+	item_sets["polling"] = std::make_unique<PollingItemSet>(config_node.child("polling"));
 
 	return item_sets;
 }
 
+// Regenerates the inputs output from a capture, without creating an instance
+static bool ReplayCapture(const pugi::xml_node& config_node, const std::string& capture_file) {
+	XrpScopedPhase phase("ReplayCapture");
+
+	InputCapture capture;
+	if (!ReadInputCapture(capture_file, capture)) {
+		return false;
+	}
+
+	std::vector<RuntimeMatcher> runtime_matchers;
+	CompileRuntimeMatchers(config_node, runtime_matchers);
+
+	const std::string runtime_name = ResolveRuntimeName(runtime_matchers, capture.runtime_name);
+	XrpLog("Replaying %zu samples captured from: %s", capture.samples.size(), runtime_name.c_str());
+
+	XrpContext context;
+	InputItemSet input_item_set(config_node.child("inputs"));
+	if (!input_item_set.Replay(context, capture)) {
+		return false;
+	}
+
+	ItemSetOutput item_set_output;
+	if (!input_item_set.GetOutput(context, item_set_output)) {
+		return false;
+	}
+
+	SaveItemSetXML(runtime_name, item_set_output);
+
+	return true;
+}
+
 int main(int argc, char* argv[]) {
+	std::string replay_capture_file;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::string(argv[i]) == "--replay") {
+			replay_capture_file = argv[++i];
+		}
+	}
+
 	XrpContext context;
 
 	{
-		CNFGSetup("OpenXR Canonical Pose Tool", 600, 600);
-
 		// Initialize the app
 		XrpApp app = {
 			.app_name = "Pose Checker",
@@ -99,15 +164,97 @@ int main(int argc, char* argv[]) {
 			.engine_version = 1,
 		};
 
-		pugi::xml_document config_doc;
-		if (!GetConfigurationFile(config_doc)) {
-			XrpLog("Failed to parse configuration!");
-			return -1;
+		std::shared_ptr<const pugi::xml_document> config_doc;
+		{
+			XrpScopedPhase phase("GetConfigurationFile");
+			if (!GetConfigurationFile(config_doc)) {
+				XrpLog("Failed to parse configuration!");
+				return -1;
+			}
+		}
+
+		pugi::xml_node config_node = config_doc->child("canonical_pose_tool");
+
+		{
+			static const std::map<std::string, XrpLogLevel> log_levels = {
+				{"debug", XRP_LOG_LEVEL_DEBUG},
+				{"info", XRP_LOG_LEVEL_INFO},
+				{"warning", XRP_LOG_LEVEL_WARNING},
+				{"error", XRP_LOG_LEVEL_ERROR},
+			};
+
+			const std::string log_level = config_node.child("log").attribute("level").value();
+			if (log_levels.contains(log_level)) {
+				XrpSetLogLevel(log_levels.at(log_level));
+			}
+		}
+
+		if (!replay_capture_file.empty()) {
+			const bool success = ReplayCapture(config_node, replay_capture_file);
+			if (!success) {
+				XrpLog("Failed to replay capture: %s", replay_capture_file.c_str());
+			}
+
+			XrpFlushLog();
+			return success ? 0 : -1;
+		}
+
+		{
+			static const std::map<std::string, XrpFramePacing> frame_pacing_policies = {
+				{"wait_frame", XRP_FRAME_PACING_WAIT_FRAME},
+				{"fixed_sleep", XRP_FRAME_PACING_FIXED_SLEEP},
+				{"display_period", XRP_FRAME_PACING_DISPLAY_PERIOD},
+			};
+
+			const pugi::xml_node frame_pacing_node = config_node.child("frame_pacing");
+
+			const std::string policy = frame_pacing_node.attribute("policy").value();
+			if (frame_pacing_policies.contains(policy)) {
+				context.frame_pacing = frame_pacing_policies.at(policy);
+			} else if (!policy.empty()) {
+				XrpLog("Unknown frame pacing policy: %s. Using wait_frame", policy.c_str());
+			}
+
+			context.frame_pacing_sleep = std::chrono::microseconds(
+				static_cast<int64_t>(std::max(frame_pacing_node.attribute("sleep_ms").as_double(1.0), 0.0) * 1000.0));
+			context.frame_pacing_margin = std::chrono::microseconds(
+				static_cast<int64_t>(std::max(frame_pacing_node.attribute("margin_ms").as_double(2.0), 0.0) * 1000.0));
+			context.idle_poll_max_interval = std::chrono::microseconds(
+				static_cast<int64_t>(std::max(frame_pacing_node.attribute("idle_poll_max_ms").as_double(100.0), 1.0) * 1000.0));
+		}
+
+		{
+			const pugi::xml_node headless_node = config_node.child("headless");
+			if (headless_node.attribute("enabled").as_bool()) {
+				if (XrpIsHeadlessSupported()) {
+					app.headless = true;
+					app.requested_extensions.insert(XR_MND_HEADLESS_EXTENSION_NAME);
+
+					context.headless_frame_period = std::chrono::microseconds(
+						static_cast<int64_t>(std::max(headless_node.attribute("frame_period_ms").as_double(11.111), 1.0) * 1000.0));
+				} else {
+					XrpLog("Headless mode requested, but the runtime can't run headless sessions. Using a window instead");
+				}
+			}
+		}
+
+		// the window only exists to provide a graphics context for the session
+		if (!app.headless) {
+			XrpScopedPhase phase("CNFGSetup");
+			CNFGSetup("OpenXR Canonical Pose Tool", 600, 600);
+		}
+
+		{
+			const pugi::xml_node trace_node = config_node.child("trace");
+			if (trace_node.attribute("enabled").as_bool()) {
+				XrpEnableTracing(std::max(trace_node.attribute("events_per_thread").as_uint(65536), 1u));
+			}
 		}
 
-		pugi::xml_node config_node = config_doc.child("canonical_pose_tool");
+		std::vector<RuntimeMatcher> runtime_matchers;
+		CompileRuntimeMatchers(config_node, runtime_matchers);
 
-		std::vector<std::unique_ptr<IItemSet>> enabled_item_sets{};
+		std::vector<EnabledItemSet> enabled_item_sets{};
 		{
 			std::map<std::string, std::unique_ptr<IItemSet>> all_item_sets = GetAllItemSets(config_node);
 
@@ -119,15 +266,21 @@ int main(int argc, char* argv[]) {
 					continue;
 				}
 
-				enabled_item_sets.emplace_back(std::move(all_item_sets[enabled_item]));
+				enabled_item_sets.push_back({
+					.name = enabled_item,
+					.item_set = std::move(all_item_sets[enabled_item]),
+					.init_trace_name = enabled_item + ": Init",
+					.sample_trace_name = enabled_item + ": Sample",
+					.output_trace_name = enabled_item + ": GetOutput",
+				});
 				all_item_sets.erase(enabled_item);
 			}
 		}
 
 		for (const auto& item_set : enabled_item_sets) {
 			std::set<std::string> required_extensions;
-			if (!item_set->GetRequiredExtensions(required_extensions)) {
-				XrpLog("Could not get requested extensions from item set");
+			if (!item_set.item_set->GetRequiredExtensions(required_extensions)) {
+				XrpLog("Could not get requested extensions from item set: %s", item_set.name.c_str());
 
 				return -1;
 			}
@@ -141,13 +294,38 @@ int main(int argc, char* argv[]) {
 			return -1;
 		}
 
+		std::erase_if(enabled_item_sets, [&](const EnabledItemSet& item_set) {
+			if (item_set.item_set->IsSupported(context)) {
+				return false;
+			}
+
+			XrpLog("Skipping item set: %s, as the runtime doesn't support it", item_set.name.c_str());
+			return true;
+		});
+
+		// the runtime can't change while the tool is running
+		const std::string runtime_name = ResolveRuntimeName(runtime_matchers, context.instance_properties.runtimeName);
+		XrpLog("Runtime: %s", runtime_name.c_str());
+
+		context.latency_summary_path = GetBaseOutputFileName(runtime_name) + "-latency.csv";
+
+		XrpRecordMilestone("session created");
+
+		auto session_created_time = std::chrono::steady_clock::now();
+		auto session_ready_time = session_created_time;
+		bool sampling_complete = false;
+
 		if (!XrpRunFrameLoop(context, [&](XrpEvent event, XrpEventData event_data) {
 				switch (event) {
 					case XRP_EVENT_SESSION_READY: {
+						session_ready_time = std::chrono::steady_clock::now();
+						XrpRecordPhase("wait for READY", session_created_time, session_ready_time);
+
 						// Initialize the item sets
 						for (const auto& item_set : enabled_item_sets) {
-							if (!item_set->Init(context)) {
-								XrpLog("Failed to initialize item set");
+							XrpTraceScope trace_scope(item_set.init_trace_name);
+							if (!item_set.item_set->Init(context)) {
+								XrpLog("Failed to initialize item set: %s", item_set.name.c_str());
 
 								return false;
 							}
@@ -155,13 +333,35 @@ int main(int argc, char* argv[]) {
 						break;
 					}
 
+					case XRP_EVENT_SESSION_FOCUSED: {
+						XrpRecordPhase("wait for FOCUSED", session_ready_time, std::chrono::steady_clock::now());
+						break;
+					}
+
+					case XRP_EVENT_SESSION_ENDING: {
+						for (const auto& item_set : enabled_item_sets) {
+							item_set.item_set->OnSessionEnding();
+						}
+						break;
+					}
+
 					case XRP_EVENT_DO_FRAME: {
-						if (event_data.session_state != XR_SESSION_STATE_FOCUSED) {
-							XrpLog("Session not focused");
+						// headless sessions might never be focused, so just try to sample
+						if (!context.headless && event_data.session_state != XR_SESSION_STATE_FOCUSED) {
+							XrpLogMessage(XRP_LOG_LEVEL_DEBUG, "Session not focused");
 							break;
 						}
 
-						MakeFile(enabled_item_sets, context);
+						if (!SampleItemSets(enabled_item_sets, context)) {
+							break;
+						}
+
+						if (!sampling_complete) {
+							XrpRecordMilestone("sampling complete");
+							sampling_complete = true;
+						}
+
+						MakeFile(enabled_item_sets, context, runtime_name);
 						break;
 					}
 
@@ -173,6 +373,9 @@ int main(int argc, char* argv[]) {
 			})) {
 			XrpLog("run frame loop failed!");
 		}
+
+		XrpWriteTimingReport(GetBaseOutputFileName(runtime_name) + "-timing.json", runtime_name);
+		XrpWriteTrace(GetBaseOutputFileName(runtime_name) + "-trace.json");
 	}
 
 	XrpDestroy(context);
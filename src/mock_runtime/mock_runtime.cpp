@@ -0,0 +1,1052 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+// A minimal OpenXR runtime that implements just enough of the API for the tool to run without hardware. Poses are scripted
+// per binding path from an xml file, and frame timing and call latency are simulated, so runs are deterministic.
+//
+// Only headless sessions are supported: graphics bindings are ignored and nothing is ever displayed.
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define XR_USE_PLATFORM_WIN32
+#define MOCK_RUNTIME_EXPORT extern "C" __declspec(dllexport)
+#else
+#ifndef XR_USE_TIMESPEC
+#define XR_USE_TIMESPEC
+#endif
+#define MOCK_RUNTIME_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+#include "openxr/openxr.h"
+#include "openxr/openxr_loader_negotiation.h"
+#include "openxr/openxr_platform.h"
+#include "pugixml.hpp"
+
+static constexpr const char* mock_runtime_config_env = "CPT_MOCK_RUNTIME_CONFIG";
+static constexpr const char* mock_runtime_default_config = "mock_runtime.xml";
+
+static constexpr XrSystemId mock_system_id = 1;
+
+static void MockLog(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	fputs("[mock runtime] ", stderr);
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+	va_end(args);
+}
+
+template <typename Handle, typename Object>
+static Handle MockToHandle(Object* object) {
+	return (Handle)(uintptr_t)object;
+}
+
+template <typename Object, typename Handle>
+static Object* MockFromHandle(Handle handle) {
+	return (Object*)(uintptr_t)handle;
+}
+
+static XrQuaternionf operator*(const XrQuaternionf& lhs, const XrQuaternionf& rhs) {
+	return {
+		.x = lhs.w * rhs.x + lhs.x * rhs.w + lhs.y * rhs.z - lhs.z * rhs.y,
+		.y = lhs.w * rhs.y - lhs.x * rhs.z + lhs.y * rhs.w + lhs.z * rhs.x,
+		.z = lhs.w * rhs.z + lhs.x * rhs.y - lhs.y * rhs.x + lhs.z * rhs.w,
+		.w = lhs.w * rhs.w - lhs.x * rhs.x - lhs.y * rhs.y - lhs.z * rhs.z,
+	};
+}
+
+static XrQuaternionf MockConjugate(const XrQuaternionf& q) { return {.x = -q.x, .y = -q.y, .z = -q.z, .w = q.w}; }
+
+static XrVector3f MockRotate(const XrQuaternionf& q, const XrVector3f& v) {
+	const XrQuaternionf rotated = q * XrQuaternionf{.x = v.x, .y = v.y, .z = v.z, .w = 0.f} * MockConjugate(q);
+	return {.x = rotated.x, .y = rotated.y, .z = rotated.z};
+}
+
+// pose b, defined in the space of pose a
+static XrPosef MockCompose(const XrPosef& a, const XrPosef& b) {
+	const XrVector3f rotated = MockRotate(a.orientation, b.position);
+	return {
+		.orientation = a.orientation * b.orientation,
+		.position = {.x = a.position.x + rotated.x, .y = a.position.y + rotated.y, .z = a.position.z + rotated.z},
+	};
+}
+
+static XrPosef MockInverse(const XrPosef& pose) {
+	const XrQuaternionf orientation = MockConjugate(pose.orientation);
+	const XrVector3f position = MockRotate(orientation, pose.position);
+	return {.orientation = orientation, .position = {.x = -position.x, .y = -position.y, .z = -position.z}};
+}
+
+struct MockActionSet {
+	std::string name;
+	bool attached = false;
+};
+
+struct MockAction {
+	MockActionSet* action_set;
+	std::string name;
+	XrActionType type;
+	std::vector<XrPath> subaction_paths;
+};
+
+struct MockSpace {
+	// null for reference spaces, which all share the origin
+	MockAction* action;
+	XrPath subaction_path;
+	XrPosef pose_in_space;
+};
+
+struct MockScriptedUserPath {
+	XrPath user_path;
+	std::string user_path_string;
+	XrPath interaction_profile;
+};
+
+struct MockRuntime {
+	std::mutex mutex;
+
+	// scripted from the config file
+	std::string runtime_name = "CPT Mock Runtime";
+	std::vector<std::string> extra_extensions;
+	std::chrono::nanoseconds frame_period{11111111};
+	std::chrono::nanoseconds call_latency{0};
+	std::vector<MockScriptedUserPath> user_paths;
+	std::unordered_map<std::string, XrPosef> poses;
+	// distance between the views of the primary stereo view configuration, in meters
+	float ipd = 0.064f;
+	// half of the field of view of each view, in radians
+	float half_fov = 0.8f;
+
+	bool instance_created = false;
+	bool session_created = false;
+	bool session_running = false;
+	XrSessionState session_state = XR_SESSION_STATE_UNKNOWN;
+	std::deque<XrEventDataBuffer> events;
+
+	// index + 1 is the XrPath
+	std::vector<std::string> path_strings;
+	std::unordered_map<std::string, XrPath> paths;
+
+	// interaction profile -> (action, binding path)
+	std::map<XrPath, std::vector<std::pair<MockAction*, XrPath>>> suggested_bindings;
+
+	std::chrono::steady_clock::time_point next_frame;
+};
+
+static MockRuntime& MockGetRuntime() {
+	static MockRuntime runtime;
+	return runtime;
+}
+
+static XrTime MockGetTime(std::chrono::steady_clock::time_point time_point) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch()).count();
+}
+
+static XrTime MockGetCurrentTime() { return MockGetTime(std::chrono::steady_clock::now()); }
+
+// every entry point takes at least this long. Busy waits, as sleeping is far too coarse for microsecond latencies
+static void MockSimulateCallLatency() {
+	const std::chrono::nanoseconds call_latency = MockGetRuntime().call_latency;
+	if (call_latency.count() <= 0) {
+		return;
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + call_latency;
+	while (std::chrono::steady_clock::now() < deadline) {
+	}
+}
+
+static XrPath MockInternPath(MockRuntime& runtime, const std::string& path) {
+	const auto existing_path = runtime.paths.find(path);
+	if (existing_path != runtime.paths.end()) {
+		return existing_path->second;
+	}
+
+	runtime.path_strings.push_back(path);
+	const XrPath xr_path = runtime.path_strings.size();
+	runtime.paths[path] = xr_path;
+
+	return xr_path;
+}
+
+static const std::string* MockGetPathString(const MockRuntime& runtime, XrPath path) {
+	if (path == XR_NULL_PATH || path > runtime.path_strings.size()) {
+		return nullptr;
+	}
+
+	return &runtime.path_strings[path - 1];
+}
+
+static bool MockParseFloats(const char* value, float* out_values, int count) {
+	char* end = nullptr;
+	for (int i = 0; i < count; i++) {
+		out_values[i] = strtof(value, &end);
+		if (end == value) {
+			return false;
+		}
+		value = end;
+	}
+
+	return true;
+}
+
+static bool MockLoadConfig(MockRuntime& runtime) {
+	const char* config_path = getenv(mock_runtime_config_env);
+	if (!config_path) {
+		config_path = mock_runtime_default_config;
+	}
+
+	pugi::xml_document config_doc;
+	if (!config_doc.load_file(config_path)) {
+		MockLog("failed to load config: %s", config_path);
+		return false;
+	}
+
+	const pugi::xml_node config_node = config_doc.child("mock_runtime");
+
+	runtime.runtime_name = config_node.attribute("runtime_name").as_string(runtime.runtime_name.c_str());
+	runtime.frame_period = std::chrono::nanoseconds(static_cast<int64_t>(std::max(config_node.attribute("frame_period_ms").as_double(11.111), 0.1) * 1e6));
+	runtime.call_latency = std::chrono::nanoseconds(static_cast<int64_t>(config_node.attribute("call_latency_us").as_double(0.0) * 1e3));
+
+	runtime.ipd = config_node.attribute("ipd").as_float(runtime.ipd);
+	runtime.half_fov = config_node.attribute("half_fov").as_float(runtime.half_fov);
+
+	for (const pugi::xml_node extension_node : config_node.child("extensions").children("extension")) {
+		runtime.extra_extensions.emplace_back(extension_node.text().get());
+	}
+
+	for (const pugi::xml_node user_path_node : config_node.children("user_path")) {
+		const std::string user_path = user_path_node.attribute("path").value();
+
+		runtime.user_paths.push_back({
+			.user_path = MockInternPath(runtime, user_path),
+			.user_path_string = user_path,
+			.interaction_profile = MockInternPath(runtime, user_path_node.attribute("interaction_profile").value()),
+		});
+
+		for (const pugi::xml_node pose_node : user_path_node.children("pose")) {
+			XrPosef pose = {.orientation = {.x = 0.f, .y = 0.f, .z = 0.f, .w = 1.f}, .position = {.x = 0.f, .y = 0.f, .z = 0.f}};
+
+			float position[3];
+			float orientation[4];
+			if (!MockParseFloats(pose_node.attribute("position").as_string("0 0 0"), position, 3) ||
+				!MockParseFloats(pose_node.attribute("orientation").as_string("0 0 0 1"), orientation, 4)) {
+				MockLog("invalid pose for %s%s", user_path.c_str(), pose_node.attribute("binding").value());
+				return false;
+			}
+
+			pose.position = {.x = position[0], .y = position[1], .z = position[2]};
+			pose.orientation = {.x = orientation[0], .y = orientation[1], .z = orientation[2], .w = orientation[3]};
+
+			runtime.poses[user_path + pose_node.attribute("binding").value()] = pose;
+		}
+	}
+
+	MockLog("loaded %zu scripted poses from %s", runtime.poses.size(), config_path);
+
+	return true;
+}
+
+static std::vector<std::string> MockGetSupportedExtensions(const MockRuntime& runtime) {
+	std::vector<std::string> extensions = {
+		XR_MND_HEADLESS_EXTENSION_NAME,
+#ifdef XR_KHR_locate_spaces
+		XR_KHR_LOCATE_SPACES_EXTENSION_NAME,
+#endif
+#if defined(XR_USE_TIMESPEC)
+		XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME,
+#elif defined(XR_USE_PLATFORM_WIN32)
+		XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME,
+#endif
+	};
+	extensions.insert(extensions.end(), runtime.extra_extensions.begin(), runtime.extra_extensions.end());
+
+	return extensions;
+}
+
+static void MockPushSessionState(MockRuntime& runtime, XrSession session, XrSessionState state) {
+	XrEventDataBuffer event = {.type = XR_TYPE_EVENT_DATA_BUFFER};
+
+	auto* session_state_changed = reinterpret_cast<XrEventDataSessionStateChanged*>(&event);
+	*session_state_changed = {
+		.type = XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED,
+		.next = nullptr,
+		.session = session,
+		.state = state,
+		.time = MockGetCurrentTime(),
+	};
+
+	runtime.events.push_back(event);
+	runtime.session_state = state;
+}
+
+static const MockScriptedUserPath* MockFindUserPath(const MockRuntime& runtime, XrPath user_path) {
+	for (const MockScriptedUserPath& scripted_user_path : runtime.user_paths) {
+		if (scripted_user_path.user_path == user_path) {
+			return &scripted_user_path;
+		}
+	}
+
+	return nullptr;
+}
+
+// the scripted pose of the binding an action is bound to in the current interaction profile, or nullptr if it isn't bound
+static const XrPosef* MockResolveActionPose(const MockRuntime& runtime, const MockAction* action, XrPath subaction_path) {
+	if (!action->action_set->attached) {
+		return nullptr;
+	}
+
+	for (const MockScriptedUserPath& user_path : runtime.user_paths) {
+		if (subaction_path != XR_NULL_PATH && subaction_path != user_path.user_path) {
+			continue;
+		}
+
+		const auto bindings = runtime.suggested_bindings.find(user_path.interaction_profile);
+		if (bindings == runtime.suggested_bindings.end()) {
+			continue;
+		}
+
+		for (const auto& binding : bindings->second) {
+			if (binding.first != action) {
+				continue;
+			}
+
+			const std::string* binding_path = MockGetPathString(runtime, binding.second);
+			if (!binding_path || !binding_path->starts_with(user_path.user_path_string + "/")) {
+				continue;
+			}
+
+			const auto pose = runtime.poses.find(*binding_path);
+			if (pose != runtime.poses.end()) {
+				return &pose->second;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+// pose of a space relative to the origin, or false if it can't be located
+static bool MockGetSpacePose(const MockRuntime& runtime, const MockSpace* space, XrPosef& out_pose) {
+	if (!space->action) {
+		out_pose = space->pose_in_space;
+		return true;
+	}
+
+	const XrPosef* action_pose = MockResolveActionPose(runtime, space->action, space->subaction_path);
+	if (!action_pose) {
+		return false;
+	}
+
+	out_pose = MockCompose(*action_pose, space->pose_in_space);
+	return true;
+}
+
+static void MockLocateSpaceInBase(const MockRuntime& runtime, XrSpace space, XrSpace base_space, XrSpaceLocationFlags& out_flags, XrPosef& out_pose) {
+	XrPosef space_pose;
+	XrPosef base_pose;
+	if (!MockGetSpacePose(runtime, MockFromHandle<MockSpace>(space), space_pose) ||
+		!MockGetSpacePose(runtime, MockFromHandle<MockSpace>(base_space), base_pose)) {
+		out_flags = 0;
+		out_pose = {.orientation = {.x = 0.f, .y = 0.f, .z = 0.f, .w = 1.f}, .position = {.x = 0.f, .y = 0.f, .z = 0.f}};
+		return;
+	}
+
+	out_flags = XR_SPACE_LOCATION_POSITION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT |
+				XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+	out_pose = MockCompose(MockInverse(base_pose), space_pose);
+}
+
+// scripted poses never move, so every located space is at rest
+static void MockGetSpaceVelocity(XrSpaceLocationFlags location_flags, XrSpaceVelocityFlags& out_flags, XrVector3f& out_linear_velocity,
+								 XrVector3f& out_angular_velocity) {
+	out_flags = location_flags != 0 ? XR_SPACE_VELOCITY_LINEAR_VALID_BIT | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT : 0;
+	out_linear_velocity = {.x = 0.f, .y = 0.f, .z = 0.f};
+	out_angular_velocity = {.x = 0.f, .y = 0.f, .z = 0.f};
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateApiLayerProperties(uint32_t property_capacity_input, uint32_t* property_count_output,
+																	  XrApiLayerProperties* properties) {
+	*property_count_output = 0;
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateInstanceExtensionProperties(const char* layer_name, uint32_t property_capacity_input,
+																			   uint32_t* property_count_output, XrExtensionProperties* properties) {
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	const std::vector<std::string> extensions = MockGetSupportedExtensions(runtime);
+
+	*property_count_output = static_cast<uint32_t>(extensions.size());
+	if (property_capacity_input == 0) {
+		return XR_SUCCESS;
+	}
+	if (property_capacity_input < extensions.size()) {
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	}
+
+	for (size_t i = 0; i < extensions.size(); i++) {
+		snprintf(properties[i].extensionName, sizeof(properties[i].extensionName), "%s", extensions[i].c_str());
+		properties[i].extensionVersion = 1;
+	}
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockCreateInstance(const XrInstanceCreateInfo* create_info, XrInstance* instance) {
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (runtime.instance_created) {
+		return XR_ERROR_LIMIT_REACHED;
+	}
+
+	const std::vector<std::string> extensions = MockGetSupportedExtensions(runtime);
+	for (uint32_t i = 0; i < create_info->enabledExtensionCount; i++) {
+		if (std::find(extensions.begin(), extensions.end(), create_info->enabledExtensionNames[i]) == extensions.end()) {
+			MockLog("unsupported extension requested: %s", create_info->enabledExtensionNames[i]);
+			return XR_ERROR_EXTENSION_NOT_PRESENT;
+		}
+	}
+
+	runtime.instance_created = true;
+	*instance = MockToHandle<XrInstance>(&runtime);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockDestroyInstance(XrInstance instance) {
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	runtime.instance_created = false;
+	runtime.suggested_bindings.clear();
+	runtime.events.clear();
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProperties(XrInstance instance, XrInstanceProperties* instance_properties) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	instance_properties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+	snprintf(instance_properties->runtimeName, sizeof(instance_properties->runtimeName), "%s", runtime.runtime_name.c_str());
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockResultToString(XrInstance instance, XrResult value, char buffer[XR_MAX_RESULT_STRING_SIZE]) {
+	if (XR_SUCCEEDED(value)) {
+		snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "XR_UNKNOWN_SUCCESS_%d", value);
+	} else {
+		snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "XR_UNKNOWN_FAILURE_%d", value);
+	}
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockPollEvent(XrInstance instance, XrEventDataBuffer* event_data) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (runtime.events.empty()) {
+		return XR_EVENT_UNAVAILABLE;
+	}
+
+	*event_data = runtime.events.front();
+	runtime.events.pop_front();
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockStringToPath(XrInstance instance, const char* path_string, XrPath* path) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (path_string[0] != '/') {
+		return XR_ERROR_PATH_FORMAT_INVALID;
+	}
+
+	*path = MockInternPath(runtime, path_string);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockPathToString(XrInstance instance, XrPath path, uint32_t buffer_capacity_input,
+													   uint32_t* buffer_count_output, char* buffer) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	const std::string* path_string = MockGetPathString(runtime, path);
+	if (!path_string) {
+		return XR_ERROR_PATH_INVALID;
+	}
+
+	*buffer_count_output = static_cast<uint32_t>(path_string->size() + 1);
+	if (buffer_capacity_input == 0) {
+		return XR_SUCCESS;
+	}
+	if (buffer_capacity_input < *buffer_count_output) {
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	}
+
+	memcpy(buffer, path_string->c_str(), *buffer_count_output);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockGetSystem(XrInstance instance, const XrSystemGetInfo* get_info, XrSystemId* system_id) {
+	MockSimulateCallLatency();
+
+	if (get_info->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY) {
+		return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+	}
+
+	*system_id = mock_system_id;
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockCreateSession(XrInstance instance, const XrSessionCreateInfo* create_info, XrSession* session) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (create_info->systemId != mock_system_id) {
+		return XR_ERROR_SYSTEM_INVALID;
+	}
+	if (runtime.session_created) {
+		return XR_ERROR_LIMIT_REACHED;
+	}
+
+	runtime.session_created = true;
+	*session = MockToHandle<XrSession>(&runtime);
+
+	MockPushSessionState(runtime, *session, XR_SESSION_STATE_IDLE);
+	MockPushSessionState(runtime, *session, XR_SESSION_STATE_READY);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockDestroySession(XrSession session) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	runtime.session_created = false;
+	runtime.session_running = false;
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockBeginSession(XrSession session, const XrSessionBeginInfo* begin_info) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (runtime.session_running) {
+		return XR_ERROR_SESSION_RUNNING;
+	}
+
+	runtime.session_running = true;
+	runtime.next_frame = std::chrono::steady_clock::now();
+
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_SYNCHRONIZED);
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_VISIBLE);
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_FOCUSED);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockRequestExitSession(XrSession session) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (!runtime.session_running) {
+		return XR_ERROR_SESSION_NOT_RUNNING;
+	}
+
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_VISIBLE);
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_SYNCHRONIZED);
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_STOPPING);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockEndSession(XrSession session) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (!runtime.session_running) {
+		return XR_ERROR_SESSION_NOT_RUNNING;
+	}
+
+	runtime.session_running = false;
+
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_IDLE);
+	MockPushSessionState(runtime, session, XR_SESSION_STATE_EXITING);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockWaitFrame(XrSession session, const XrFrameWaitInfo* frame_wait_info, XrFrameState* frame_state) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+
+	std::chrono::steady_clock::time_point frame_time;
+	std::chrono::nanoseconds frame_period;
+	{
+		std::scoped_lock lock(runtime.mutex);
+		if (!runtime.session_running) {
+			return XR_ERROR_SESSION_NOT_RUNNING;
+		}
+
+		// don't try to catch up on frames that were missed
+		const auto now = std::chrono::steady_clock::now();
+		while (runtime.next_frame <= now) {
+			runtime.next_frame += runtime.frame_period;
+		}
+
+		frame_time = runtime.next_frame;
+		frame_period = runtime.frame_period;
+		runtime.next_frame += runtime.frame_period;
+	}
+
+	std::this_thread::sleep_until(frame_time);
+
+	frame_state->predictedDisplayTime = MockGetTime(frame_time + frame_period);
+	frame_state->predictedDisplayPeriod = frame_period.count();
+	frame_state->shouldRender = XR_FALSE;
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockBeginFrame(XrSession session, const XrFrameBeginInfo* frame_begin_info) {
+	MockSimulateCallLatency();
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockEndFrame(XrSession session, const XrFrameEndInfo* frame_end_info) {
+	MockSimulateCallLatency();
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockCreateReferenceSpace(XrSession session, const XrReferenceSpaceCreateInfo* create_info, XrSpace* space) {
+	MockSimulateCallLatency();
+
+	*space = MockToHandle<XrSpace>(new MockSpace{.action = nullptr, .subaction_path = XR_NULL_PATH, .pose_in_space = create_info->poseInReferenceSpace});
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockCreateActionSpace(XrSession session, const XrActionSpaceCreateInfo* create_info, XrSpace* space) {
+	MockSimulateCallLatency();
+
+	MockAction* action = MockFromHandle<MockAction>(create_info->action);
+	if (action->type != XR_ACTION_TYPE_POSE_INPUT) {
+		return XR_ERROR_ACTION_TYPE_MISMATCH;
+	}
+
+	*space = MockToHandle<XrSpace>(new MockSpace{
+		.action = action,
+		.subaction_path = create_info->subactionPath,
+		.pose_in_space = create_info->poseInActionSpace,
+	});
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockDestroySpace(XrSpace space) {
+	MockSimulateCallLatency();
+
+	delete MockFromHandle<MockSpace>(space);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockLocateSpace(XrSpace space, XrSpace base_space, XrTime time, XrSpaceLocation* location) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	MockLocateSpaceInBase(runtime, space, base_space, location->locationFlags, location->pose);
+
+	for (XrBaseOutStructure* next = static_cast<XrBaseOutStructure*>(location->next); next; next = next->next) {
+		if (next->type == XR_TYPE_SPACE_VELOCITY) {
+			XrSpaceVelocity* velocity = reinterpret_cast<XrSpaceVelocity*>(next);
+			MockGetSpaceVelocity(location->locationFlags, velocity->velocityFlags, velocity->linearVelocity, velocity->angularVelocity);
+		}
+	}
+
+	return XR_SUCCESS;
+}
+
+#ifdef XR_KHR_locate_spaces
+static XRAPI_ATTR XrResult XRAPI_CALL MockLocateSpaces(XrSession session, const XrSpacesLocateInfoKHR* locate_info, XrSpaceLocationsKHR* space_locations) {
+	MockSimulateCallLatency();
+
+	if (locate_info->spaceCount != space_locations->locationCount) {
+		return XR_ERROR_VALIDATION_FAILURE;
+	}
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	for (uint32_t i = 0; i < locate_info->spaceCount; i++) {
+		MockLocateSpaceInBase(runtime, locate_info->spaces[i], locate_info->baseSpace, space_locations->locations[i].locationFlags,
+						space_locations->locations[i].pose);
+	}
+
+	for (XrBaseOutStructure* next = static_cast<XrBaseOutStructure*>(space_locations->next); next; next = next->next) {
+		if (next->type != XR_TYPE_SPACE_VELOCITIES_KHR) {
+			continue;
+		}
+
+		XrSpaceVelocitiesKHR* velocities = reinterpret_cast<XrSpaceVelocitiesKHR*>(next);
+		if (velocities->velocityCount != locate_info->spaceCount) {
+			return XR_ERROR_VALIDATION_FAILURE;
+		}
+
+		for (uint32_t i = 0; i < velocities->velocityCount; i++) {
+			MockGetSpaceVelocity(space_locations->locations[i].locationFlags, velocities->velocities[i].velocityFlags,
+								 velocities->velocities[i].linearVelocity, velocities->velocities[i].angularVelocity);
+		}
+	}
+
+	return XR_SUCCESS;
+}
+#endif
+
+// views are fixed relative to the head, which is at the origin of every reference space
+static XRAPI_ATTR XrResult XRAPI_CALL MockLocateViews(XrSession session, const XrViewLocateInfo* view_locate_info, XrViewState* view_state,
+													  uint32_t view_capacity_input, uint32_t* view_count_output, XrView* views) {
+	MockSimulateCallLatency();
+
+	if (view_locate_info->viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+		return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+	}
+
+	constexpr uint32_t mock_view_count = 2;
+	*view_count_output = mock_view_count;
+	if (view_capacity_input == 0) {
+		return XR_SUCCESS;
+	}
+	if (view_capacity_input < mock_view_count) {
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	}
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	XrPosef head_pose;
+	if (!MockGetSpacePose(runtime, MockFromHandle<MockSpace>(view_locate_info->space), head_pose)) {
+		view_state->viewStateFlags = 0;
+		return XR_SUCCESS;
+	}
+	head_pose = MockInverse(head_pose);
+
+	for (uint32_t i = 0; i < mock_view_count; i++) {
+		const float eye_offset = (i == 0 ? -0.5f : 0.5f) * runtime.ipd;
+		const XrPosef eye_pose = {.orientation = {.x = 0.f, .y = 0.f, .z = 0.f, .w = 1.f}, .position = {.x = eye_offset, .y = 0.f, .z = 0.f}};
+
+		views[i].pose = MockCompose(head_pose, eye_pose);
+		views[i].fov = {
+			.angleLeft = -runtime.half_fov,
+			.angleRight = runtime.half_fov,
+			.angleUp = runtime.half_fov,
+			.angleDown = -runtime.half_fov,
+		};
+	}
+
+	view_state->viewStateFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT | XR_VIEW_STATE_ORIENTATION_TRACKED_BIT |
+								 XR_VIEW_STATE_POSITION_TRACKED_BIT;
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockCreateActionSet(XrInstance instance, const XrActionSetCreateInfo* create_info, XrActionSet* action_set) {
+	MockSimulateCallLatency();
+
+	*action_set = MockToHandle<XrActionSet>(new MockActionSet{.name = create_info->actionSetName});
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockDestroyActionSet(XrActionSet action_set) {
+	MockSimulateCallLatency();
+
+	delete MockFromHandle<MockActionSet>(action_set);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockCreateAction(XrActionSet action_set, const XrActionCreateInfo* create_info, XrAction* action) {
+	MockSimulateCallLatency();
+
+	*action = MockToHandle<XrAction>(new MockAction{
+		.action_set = MockFromHandle<MockActionSet>(action_set),
+		.name = create_info->actionName,
+		.type = create_info->actionType,
+		.subaction_paths = std::vector<XrPath>(create_info->subactionPaths, create_info->subactionPaths + create_info->countSubactionPaths),
+	});
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockDestroyAction(XrAction action) {
+	MockSimulateCallLatency();
+
+	delete MockFromHandle<MockAction>(action);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockSuggestInteractionProfileBindings(XrInstance instance, const XrInteractionProfileSuggestedBinding* suggested_bindings) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	auto& bindings = runtime.suggested_bindings[suggested_bindings->interactionProfile];
+	bindings.clear();
+	for (uint32_t i = 0; i < suggested_bindings->countSuggestedBindings; i++) {
+		bindings.emplace_back(MockFromHandle<MockAction>(suggested_bindings->suggestedBindings[i].action), suggested_bindings->suggestedBindings[i].binding);
+	}
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockAttachSessionActionSets(XrSession session, const XrSessionActionSetsAttachInfo* attach_info) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	for (uint32_t i = 0; i < attach_info->countActionSets; i++) {
+		MockActionSet* action_set = MockFromHandle<MockActionSet>(attach_info->actionSets[i]);
+		if (action_set->attached) {
+			return XR_ERROR_ACTIONSETS_ALREADY_ATTACHED;
+		}
+
+		action_set->attached = true;
+	}
+
+	// the scripted interaction profiles become current as soon as there is something to bind to
+	XrEventDataBuffer event = {.type = XR_TYPE_EVENT_DATA_BUFFER};
+	*reinterpret_cast<XrEventDataInteractionProfileChanged*>(&event) = {
+		.type = XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED,
+		.next = nullptr,
+		.session = session,
+	};
+	runtime.events.push_back(event);
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockGetCurrentInteractionProfile(XrSession session, XrPath top_level_user_path,
+																	   XrInteractionProfileState* interaction_profile) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	const MockScriptedUserPath* user_path = MockFindUserPath(runtime, top_level_user_path);
+	interaction_profile->interactionProfile = user_path ? user_path->interaction_profile : XR_NULL_PATH;
+
+	// only report profiles the app suggested bindings for, like a real runtime would
+	if (!runtime.suggested_bindings.contains(interaction_profile->interactionProfile)) {
+		interaction_profile->interactionProfile = XR_NULL_PATH;
+	}
+
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockSyncActions(XrSession session, const XrActionsSyncInfo* sync_info) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	if (!runtime.session_running) {
+		return XR_ERROR_SESSION_NOT_RUNNING;
+	}
+
+	return runtime.session_state == XR_SESSION_STATE_FOCUSED ? XR_SUCCESS : XR_SESSION_NOT_FOCUSED;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStatePose(XrSession session, const XrActionStateGetInfo* get_info, XrActionStatePose* state) {
+	MockSimulateCallLatency();
+
+	MockRuntime& runtime = MockGetRuntime();
+	std::scoped_lock lock(runtime.mutex);
+
+	state->isActive = MockResolveActionPose(runtime, MockFromHandle<MockAction>(get_info->action), get_info->subactionPath) != nullptr;
+
+	return XR_SUCCESS;
+}
+
+#if defined(XR_USE_TIMESPEC)
+static XRAPI_ATTR XrResult XRAPI_CALL MockConvertTimespecTimeToTime(XrInstance instance, const struct timespec* timespec_time, XrTime* time) {
+	MockSimulateCallLatency();
+
+	// steady_clock is CLOCK_MONOTONIC
+	*time = static_cast<XrTime>(timespec_time->tv_sec) * 1000000000 + timespec_time->tv_nsec;
+
+	return XR_SUCCESS;
+}
+#elif defined(XR_USE_PLATFORM_WIN32)
+static XRAPI_ATTR XrResult XRAPI_CALL MockConvertWin32PerformanceCounterToTime(XrInstance instance, const LARGE_INTEGER* performance_counter,
+																			   XrTime* time) {
+	MockSimulateCallLatency();
+
+	// steady_clock is QueryPerformanceCounter
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	*time = static_cast<XrTime>(performance_counter->QuadPart / frequency.QuadPart) * 1000000000 +
+			(performance_counter->QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+
+	return XR_SUCCESS;
+}
+#endif
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+
+// functions that can be called without an instance
+static const std::unordered_map<std::string, PFN_xrVoidFunction> mock_global_functions = {
+	{"xrGetInstanceProcAddr", reinterpret_cast<PFN_xrVoidFunction>(MockGetInstanceProcAddr)},
+	{"xrEnumerateApiLayerProperties", reinterpret_cast<PFN_xrVoidFunction>(MockEnumerateApiLayerProperties)},
+	{"xrEnumerateInstanceExtensionProperties", reinterpret_cast<PFN_xrVoidFunction>(MockEnumerateInstanceExtensionProperties)},
+	{"xrCreateInstance", reinterpret_cast<PFN_xrVoidFunction>(MockCreateInstance)},
+};
+
+static const std::unordered_map<std::string, PFN_xrVoidFunction> mock_instance_functions = {
+	{"xrDestroyInstance", reinterpret_cast<PFN_xrVoidFunction>(MockDestroyInstance)},
+	{"xrGetInstanceProperties", reinterpret_cast<PFN_xrVoidFunction>(MockGetInstanceProperties)},
+	{"xrResultToString", reinterpret_cast<PFN_xrVoidFunction>(MockResultToString)},
+	{"xrPollEvent", reinterpret_cast<PFN_xrVoidFunction>(MockPollEvent)},
+	{"xrStringToPath", reinterpret_cast<PFN_xrVoidFunction>(MockStringToPath)},
+	{"xrPathToString", reinterpret_cast<PFN_xrVoidFunction>(MockPathToString)},
+	{"xrGetSystem", reinterpret_cast<PFN_xrVoidFunction>(MockGetSystem)},
+	{"xrCreateSession", reinterpret_cast<PFN_xrVoidFunction>(MockCreateSession)},
+	{"xrDestroySession", reinterpret_cast<PFN_xrVoidFunction>(MockDestroySession)},
+	{"xrBeginSession", reinterpret_cast<PFN_xrVoidFunction>(MockBeginSession)},
+	{"xrRequestExitSession", reinterpret_cast<PFN_xrVoidFunction>(MockRequestExitSession)},
+	{"xrEndSession", reinterpret_cast<PFN_xrVoidFunction>(MockEndSession)},
+	{"xrWaitFrame", reinterpret_cast<PFN_xrVoidFunction>(MockWaitFrame)},
+	{"xrBeginFrame", reinterpret_cast<PFN_xrVoidFunction>(MockBeginFrame)},
+	{"xrEndFrame", reinterpret_cast<PFN_xrVoidFunction>(MockEndFrame)},
+	{"xrCreateReferenceSpace", reinterpret_cast<PFN_xrVoidFunction>(MockCreateReferenceSpace)},
+	{"xrCreateActionSpace", reinterpret_cast<PFN_xrVoidFunction>(MockCreateActionSpace)},
+	{"xrDestroySpace", reinterpret_cast<PFN_xrVoidFunction>(MockDestroySpace)},
+	{"xrLocateSpace", reinterpret_cast<PFN_xrVoidFunction>(MockLocateSpace)},
+#ifdef XR_KHR_locate_spaces
+	{"xrLocateSpaces", reinterpret_cast<PFN_xrVoidFunction>(MockLocateSpaces)},
+	{"xrLocateSpacesKHR", reinterpret_cast<PFN_xrVoidFunction>(MockLocateSpaces)},
+#endif
+	{"xrLocateViews", reinterpret_cast<PFN_xrVoidFunction>(MockLocateViews)},
+	{"xrCreateActionSet", reinterpret_cast<PFN_xrVoidFunction>(MockCreateActionSet)},
+	{"xrDestroyActionSet", reinterpret_cast<PFN_xrVoidFunction>(MockDestroyActionSet)},
+	{"xrCreateAction", reinterpret_cast<PFN_xrVoidFunction>(MockCreateAction)},
+	{"xrDestroyAction", reinterpret_cast<PFN_xrVoidFunction>(MockDestroyAction)},
+	{"xrSuggestInteractionProfileBindings", reinterpret_cast<PFN_xrVoidFunction>(MockSuggestInteractionProfileBindings)},
+	{"xrAttachSessionActionSets", reinterpret_cast<PFN_xrVoidFunction>(MockAttachSessionActionSets)},
+	{"xrGetCurrentInteractionProfile", reinterpret_cast<PFN_xrVoidFunction>(MockGetCurrentInteractionProfile)},
+	{"xrSyncActions", reinterpret_cast<PFN_xrVoidFunction>(MockSyncActions)},
+	{"xrGetActionStatePose", reinterpret_cast<PFN_xrVoidFunction>(MockGetActionStatePose)},
+#if defined(XR_USE_TIMESPEC)
+	{"xrConvertTimespecTimeToTimeKHR", reinterpret_cast<PFN_xrVoidFunction>(MockConvertTimespecTimeToTime)},
+#elif defined(XR_USE_PLATFORM_WIN32)
+	{"xrConvertWin32PerformanceCounterToTimeKHR", reinterpret_cast<PFN_xrVoidFunction>(MockConvertWin32PerformanceCounterToTime)},
+#endif
+};
+
+static XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+	*function = nullptr;
+
+	const auto global_function = mock_global_functions.find(name);
+	if (global_function != mock_global_functions.end()) {
+		*function = global_function->second;
+		return XR_SUCCESS;
+	}
+
+	if (instance == XR_NULL_HANDLE) {
+		return XR_ERROR_HANDLE_INVALID;
+	}
+
+	const auto instance_function = mock_instance_functions.find(name);
+	if (instance_function == mock_instance_functions.end()) {
+		return XR_ERROR_FUNCTION_UNSUPPORTED;
+	}
+
+	*function = instance_function->second;
+
+	return XR_SUCCESS;
+}
+
+MOCK_RUNTIME_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrNegotiateLoaderRuntimeInterface(const XrNegotiateLoaderInfo* loader_info,
+																					  XrNegotiateRuntimeRequest* runtime_request) {
+	if (!loader_info || !runtime_request || loader_info->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
+		loader_info->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loader_info->structSize != sizeof(XrNegotiateLoaderInfo) ||
+		runtime_request->structType != XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST ||
+		runtime_request->structVersion != XR_RUNTIME_INFO_STRUCT_VERSION || runtime_request->structSize != sizeof(XrNegotiateRuntimeRequest)) {
+		return XR_ERROR_INITIALIZATION_FAILED;
+	}
+
+	if (loader_info->minInterfaceVersion > XR_CURRENT_LOADER_RUNTIME_VERSION || loader_info->maxInterfaceVersion < XR_CURRENT_LOADER_RUNTIME_VERSION) {
+		return XR_ERROR_INITIALIZATION_FAILED;
+	}
+
+	MockRuntime& runtime = MockGetRuntime();
+	{
+		std::scoped_lock lock(runtime.mutex);
+		if (!MockLoadConfig(runtime)) {
+			return XR_ERROR_INITIALIZATION_FAILED;
+		}
+	}
+
+	runtime_request->runtimeInterfaceVersion = XR_CURRENT_LOADER_RUNTIME_VERSION;
+	runtime_request->runtimeApiVersion = XR_CURRENT_API_VERSION;
+	runtime_request->getInstanceProcAddr = MockGetInstanceProcAddr;
+
+	return XR_SUCCESS;
+}
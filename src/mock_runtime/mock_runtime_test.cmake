@@ -0,0 +1,88 @@
+# Runs the tool end to end against the mock runtime in a clean working directory, and checks the poses it wrote against the ones
+# scripted in mock_runtime.xml.
+# Expects TOOL, RUNTIME_JSON, SOURCE_DIR (src/mock_runtime) and WORK_DIR to be defined. If OUTPUT_BUDGET_MS is defined, the test
+# also fails if the output took longer than that to be written.
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+configure_file(${SOURCE_DIR}/mock_runtime_test_config.xml ${WORK_DIR}/cpt_config.xml COPYONLY)
+
+set(ENV{XR_RUNTIME_JSON} ${RUNTIME_JSON})
+set(ENV{CPT_MOCK_RUNTIME_CONFIG} ${SOURCE_DIR}/mock_runtime.xml)
+
+execute_process(
+        COMMAND ${TOOL}
+        WORKING_DIRECTORY ${WORK_DIR}
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE tool_output
+        ERROR_VARIABLE tool_output
+        TIMEOUT 60
+)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${TOOL} failed: ${result}\n${tool_output}")
+endif ()
+
+# the tool exits successfully even if the frame loop failed
+if (tool_output MATCHES "run frame loop failed")
+    message(FATAL_ERROR "the frame loop failed\n${tool_output}")
+endif ()
+
+foreach (output cpt_Mock-valve_index_controller.xml cpt_Mock-timing.json)
+    if (NOT EXISTS ${WORK_DIR}/${output})
+        message(FATAL_ERROR "${output} was not written\n${tool_output}")
+    endif ()
+endforeach ()
+
+# Checks the X, Y, Z (and W) values of the position or orientation node of the pose bound to binding_path, as formatted in the output
+function(check_pose_node xml binding_path node_name expected)
+    string(FIND "${xml}" "binding_path=\"${binding_path}\"" pose_start)
+    if (pose_start EQUAL -1)
+        message(FATAL_ERROR "no pose was written for ${binding_path}")
+    endif ()
+    string(SUBSTRING "${xml}" ${pose_start} -1 pose)
+    string(FIND "${pose}" "</pose>" pose_end)
+    string(SUBSTRING "${pose}" 0 ${pose_end} pose)
+
+    string(FIND "${pose}" "<${node_name}" node_start)
+    string(SUBSTRING "${pose}" ${node_start} -1 node)
+    string(FIND "${node}" "</${node_name}>" node_end)
+    string(SUBSTRING "${node}" 0 ${node_end} node)
+
+    set(index 0)
+    foreach (component ${ARGN})
+        list(GET expected ${index} value)
+        math(EXPR index "${index} + 1")
+        string(REGEX MATCH "<${component}>([^<]*)</${component}>" match "${node}")
+        set(written "${CMAKE_MATCH_1}")
+        # rounding can leave a negative zero
+        string(REGEX REPLACE "^-(0\\.0*)$" "\\1" actual "${written}")
+        if (NOT actual STREQUAL value)
+            message(FATAL_ERROR "${binding_path} ${node_name} ${component} is ${written}, expected ${value}")
+        endif ()
+    endforeach ()
+endfunction()
+
+file(READ ${WORK_DIR}/cpt_Mock-valve_index_controller.xml inputs_xml)
+
+# aim is scripted 1cm below and 5cm in front of grip, pitched down by 30 degrees, on both hands
+foreach (hand left right)
+    check_pose_node("${inputs_xml}" /user/hand/${hand}/input/aim/pose position "0.000;-0.010;-0.050" X Y Z)
+    check_pose_node("${inputs_xml}" /user/hand/${hand}/input/aim/pose orientation "0.97;-0.26;0.00;0.00" W X Y Z)
+endforeach ()
+
+file(READ ${WORK_DIR}/cpt_Mock-timing.json timing_json)
+if (NOT timing_json MATCHES "\"name\": \"output written\", \"time_ms\": ([0-9.]+)")
+    message(FATAL_ERROR "cpt_Mock-timing.json has no output written milestone")
+endif ()
+set(time_to_output_ms ${CMAKE_MATCH_1})
+
+message(STATUS "time to output: ${time_to_output_ms} ms")
+message(STATUS "<CTestMeasurement type=\"numeric/double\" name=\"time_to_output_ms\">${time_to_output_ms}</CTestMeasurement>")
+
+if (DEFINED OUTPUT_BUDGET_MS)
+    # math() is integer only, so compare whole milliseconds
+    string(REGEX REPLACE "\\..*" "" time_to_output_whole_ms ${time_to_output_ms})
+    if (time_to_output_whole_ms GREATER_EQUAL OUTPUT_BUDGET_MS)
+        message(FATAL_ERROR "the output took ${time_to_output_ms} ms to be written, over the budget of ${OUTPUT_BUDGET_MS} ms")
+    endif ()
+endif ()
@@ -16,27 +16,36 @@ extern android_app* gapp;
 std::string AndroidGetDataPath() { return gapp->activity->externalDataPath; }
 #endif
 
-bool GetConfigurationFile(pugi::xml_document& out_config) {
-	static pugi::xml_document config_file_xml;
-
-	if (!config_file_xml.first_child().empty()) {
-		out_config.reset(config_file_xml);
-		return true;
-	}
+std::string GetOutputDirectory() {
+#ifdef XR_USE_PLATFORM_ANDROID
+	return AndroidGetDataPath() + "/";
+#else
+	return "";
+#endif
+}
 
+static std::shared_ptr<const pugi::xml_document> LoadConfigurationFile() {
 #ifdef XR_USE_PLATFORM_ANDROID
 	std::string config_path = AndroidGetDataPath() + "/cpt_config.xml";
 #else
 	std::string config_path = "cpt_config.xml";
 #endif
 
-	if (!config_file_xml.load_file(config_path.c_str())) {
-		return false;
+	auto config_file_xml = std::make_shared<pugi::xml_document>();
+	if (!config_file_xml->load_file(config_path.c_str())) {
+		return nullptr;
 	}
 
-	out_config.reset(config_file_xml);
+	return config_file_xml;
+}
+
+bool GetConfigurationFile(std::shared_ptr<const pugi::xml_document>& out_config) {
+	// loaded on first use. Static initialization is thread safe, and the document is never modified afterwards
+	static const std::shared_ptr<const pugi::xml_document> config_file_xml = LoadConfigurationFile();
+
+	out_config = config_file_xml;
 
-	return true;
+	return out_config != nullptr;
 }
 
 std::string StripIllegalFilenameCharacters(const std::string& str, const std::string& replace_with) {
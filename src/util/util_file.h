@@ -7,6 +7,7 @@
 #pragma once
 
 #include <fstream>
+#include <memory>
 
 #include "pugixml.hpp"
 #include "xr/xrp.h"
@@ -15,6 +16,10 @@
 	std::string AndroidGetDataPath();
 #endif
 
-bool GetConfigurationFile(pugi::xml_document& out_config);
+// Where output files are written. Either empty or ends with a path separator
+std::string GetOutputDirectory();
+
+// The configuration is loaded once and shared read only between all callers
+bool GetConfigurationFile(std::shared_ptr<const pugi::xml_document>& out_config);
 
 std::string StripIllegalFilenameCharacters(const std::string& str, const std::string& replace_with = "");
\ No newline at end of file
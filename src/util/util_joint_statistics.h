@@ -0,0 +1,120 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "xr/xrp.h"
+
+// Welford update of one component of every joint. All joints share the sample count, so this is a single loop over the joints.
+template <size_t joint_count>
+static void JointWelfordAdd(double (&mean)[joint_count], double (&m2)[joint_count], const float (&values)[joint_count], double inverse_count) {
+	for (size_t i = 0; i < joint_count; i++) {
+		const double delta = values[i] - mean[i];
+		mean[i] += delta * inverse_count;
+		m2[i] += delta * (values[i] - mean[i]);
+	}
+}
+
+static float JointStandardDeviation(double m2, uint64_t count) {
+	return count > 1 ? static_cast<float>(std::sqrt(m2 / static_cast<double>(count - 1))) : 0.f;
+}
+
+// Poses of a set of joints located together, with one array per component so each component of every joint is processed in a
+// single loop
+template <size_t joint_count>
+struct JointPoseFrame {
+	// X, Y, Z
+	float position[3][joint_count];
+	// W, X, Y, Z
+	float orientation[4][joint_count];
+
+	// transposes joint locations (anything with a pose member, e.g. XrHandJointLocationEXT)
+	template <typename JointLocation>
+	void Load(const JointLocation* joint_locations) {
+		for (size_t i = 0; i < joint_count; i++) {
+			const XrPosef& pose = joint_locations[i].pose;
+
+			position[0][i] = pose.position.x;
+			position[1][i] = pose.position.y;
+			position[2][i] = pose.position.z;
+
+			orientation[0][i] = pose.orientation.w;
+			orientation[1][i] = pose.orientation.x;
+			orientation[2][i] = pose.orientation.y;
+			orientation[3][i] = pose.orientation.z;
+		}
+	}
+};
+
+// Running mean and variance of every joint's pose (Welford's algorithm, like RunningStatistics), in the same layout as
+// JointPoseFrame
+template <size_t joint_count>
+struct JointPoseStatistics {
+	uint64_t count = 0;
+
+	double position_mean[3][joint_count] = {};
+	double position_m2[3][joint_count] = {};
+	double orientation_mean[4][joint_count] = {};
+	double orientation_m2[4][joint_count] = {};
+
+	void Add(const JointPoseFrame<joint_count>& frame) {
+		// q and -q are the same rotation, so keep every sample in the same hemisphere as the mean before averaging.
+		// The mean is zero before the first sample, which keeps the first sample as it is
+		float orientation_sign[joint_count];
+		for (size_t i = 0; i < joint_count; i++) {
+			const double dot = orientation_mean[0][i] * frame.orientation[0][i] + orientation_mean[1][i] * frame.orientation[1][i] +
+							   orientation_mean[2][i] * frame.orientation[2][i] + orientation_mean[3][i] * frame.orientation[3][i];
+			orientation_sign[i] = dot < 0.0 ? -1.f : 1.f;
+		}
+
+		float orientation[4][joint_count];
+		for (size_t component = 0; component < 4; component++) {
+			for (size_t i = 0; i < joint_count; i++) {
+				orientation[component][i] = frame.orientation[component][i] * orientation_sign[i];
+			}
+		}
+
+		count++;
+		const double inverse_count = 1.0 / static_cast<double>(count);
+
+		for (size_t component = 0; component < 3; component++) {
+			JointWelfordAdd(position_mean[component], position_m2[component], frame.position[component], inverse_count);
+		}
+
+		for (size_t component = 0; component < 4; component++) {
+			JointWelfordAdd(orientation_mean[component], orientation_m2[component], orientation[component], inverse_count);
+		}
+	}
+
+	XrPosef GetMeanPose(size_t joint) const {
+		return XrpMakeMeanPose({orientation_mean[0][joint], orientation_mean[1][joint], orientation_mean[2][joint], orientation_mean[3][joint]},
+							   {position_mean[0][joint], position_mean[1][joint], position_mean[2][joint]});
+	}
+
+	// sample standard deviations
+	XrVector3f GetPositionStandardDeviation(size_t joint) const {
+		return {
+			.x = JointStandardDeviation(position_m2[0][joint], count),
+			.y = JointStandardDeviation(position_m2[1][joint], count),
+			.z = JointStandardDeviation(position_m2[2][joint], count),
+		};
+	}
+
+	XrQuaternionf GetOrientationStandardDeviation(size_t joint) const {
+		return {
+			.x = JointStandardDeviation(orientation_m2[1][joint], count),
+			.y = JointStandardDeviation(orientation_m2[2][joint], count),
+			.z = JointStandardDeviation(orientation_m2[3][joint], count),
+			.w = JointStandardDeviation(orientation_m2[0][joint], count),
+		};
+	}
+
+	void Reset() { *this = {}; }
+};
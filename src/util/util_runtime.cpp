@@ -0,0 +1,102 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "util_runtime.h"
+
+#include "xr/xrp.h"
+
+static bool IsRegexSpecialCharacter(char c) {
+	switch (c) {
+		case '.':
+		case '^':
+		case '$':
+		case '|':
+		case '(':
+		case ')':
+		case '[':
+		case ']':
+		case '{':
+		case '}':
+		case '*':
+		case '+':
+		case '?':
+		case '\\':
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool IsLiteralPattern(const std::string& pattern) {
+	for (const char c : pattern) {
+		if (IsRegexSpecialCharacter(c)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool RuntimeMatcher::Matches(const std::string& runtime_name) const {
+	switch (type) {
+		case RUNTIME_MATCH_LITERAL:
+			return runtime_name == pattern;
+		case RUNTIME_MATCH_PREFIX:
+			return runtime_name.starts_with(pattern);
+		case RUNTIME_MATCH_REGEX:
+			return regex && std::regex_match(runtime_name, *regex);
+	}
+
+	return false;
+}
+
+bool CompileRuntimeMatchers(const pugi::xml_node& config_node, std::vector<RuntimeMatcher>& out_matchers) {
+	for (const pugi::xpath_node& runtime_xpath_node : config_node.select_nodes("./runtimes/runtime")) {
+		const pugi::xml_node runtime_node = runtime_xpath_node.node();
+
+		const std::string matches = runtime_node.attribute("matches").value();
+		const std::string name = runtime_node.attribute("name").value();
+		if (matches.empty() || name.empty()) {
+			continue;
+		}
+
+		RuntimeMatcher matcher = {
+			.type = RUNTIME_MATCH_LITERAL,
+			.pattern = matches,
+			.name = name,
+		};
+
+		if (IsLiteralPattern(matches)) {
+			matcher.type = RUNTIME_MATCH_LITERAL;
+		} else if (matches.back() == '*' && IsLiteralPattern(matches.substr(0, matches.size() - 1))) {
+			matcher.type = RUNTIME_MATCH_PREFIX;
+			matcher.pattern.pop_back();
+		} else {
+			matcher.type = RUNTIME_MATCH_REGEX;
+
+			try {
+				matcher.regex = std::make_shared<const std::regex>(matches);
+			} catch (const std::regex_error&) {
+				XrpLog("Invalid runtime match pattern: %s. Skipping", matches.c_str());
+				continue;
+			}
+		}
+
+		out_matchers.push_back(std::move(matcher));
+	}
+
+	return true;
+}
+
+std::string ResolveRuntimeName(const std::vector<RuntimeMatcher>& matchers, const std::string& runtime_name) {
+	for (const RuntimeMatcher& matcher : matchers) {
+		if (matcher.Matches(runtime_name)) {
+			return matcher.name;
+		}
+	}
+
+	return runtime_name;
+}
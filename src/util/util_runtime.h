@@ -0,0 +1,38 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "pugixml.hpp"
+
+enum RuntimeMatchType {
+	RUNTIME_MATCH_LITERAL,
+	// glob with a single trailing '*', e.g. "Monado*"
+	RUNTIME_MATCH_PREFIX,
+	RUNTIME_MATCH_REGEX,
+};
+
+struct RuntimeMatcher {
+	RuntimeMatchType type;
+	std::string pattern;
+	std::string name;
+
+	// only compiled for patterns that are not literal or prefix
+	std::shared_ptr<const std::regex> regex;
+
+	bool Matches(const std::string& runtime_name) const;
+};
+
+// Compiles the matches attribute of each <runtime> node
+bool CompileRuntimeMatchers(const pugi::xml_node& config_node, std::vector<RuntimeMatcher>& out_matchers);
+
+// Returns the name of the first matcher that matches runtime_name, or runtime_name if none match
+std::string ResolveRuntimeName(const std::vector<RuntimeMatcher>& matchers, const std::string& runtime_name);
@@ -0,0 +1,53 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single-producer, single-consumer ring buffer. Allocates once on construction; neither side blocks or allocates after that.
+// When the ring is full Push fails, and the producer decides what to do with the value.
+template <typename T>
+class SpscQueue {
+   public:
+	// one cell is always left empty, to tell a full ring from an empty one
+	explicit SpscQueue(size_t capacity) : cells_(capacity + 1) {}
+
+	// producer thread only
+	bool Push(const T& value) {
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		const size_t next_tail = tail + 1 == cells_.size() ? 0 : tail + 1;
+		if (next_tail == head_.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		cells_[tail] = value;
+		tail_.store(next_tail, std::memory_order_release);
+
+		return true;
+	}
+
+	// consumer thread only
+	bool Pop(T& out_value) {
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		out_value = cells_[head];
+		head_.store(head + 1 == cells_.size() ? 0 : head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+   private:
+	std::vector<T> cells_;
+
+	alignas(64) std::atomic<size_t> head_{0};
+	alignas(64) std::atomic<size_t> tail_{0};
+};
@@ -0,0 +1,52 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Welford's online algorithm: running mean and variance in constant memory, however many samples are added.
+struct RunningStatistics {
+	uint64_t count = 0;
+	double mean = 0.0;
+	double m2 = 0.0;
+	double min = std::numeric_limits<double>::infinity();
+	double max = -std::numeric_limits<double>::infinity();
+
+	void Add(double value) {
+		count++;
+
+		const double delta = value - mean;
+		mean += delta / static_cast<double>(count);
+		m2 += delta * (value - mean);
+
+		if (value < min) min = value;
+		if (value > max) max = value;
+	}
+
+	// sample variance
+	double Variance() const { return count > 1 ? m2 / static_cast<double>(count - 1) : 0.0; }
+
+	double StandardDeviation() const { return std::sqrt(Variance()); }
+
+	void Reset() { *this = {}; }
+};
+
+// Nearest rank percentile (0 - 100) of values, which must be sorted
+template <typename T>
+static T SortedPercentile(const std::vector<T>& sorted_values, uint32_t percentile) {
+	if (sorted_values.empty()) {
+		return T{};
+	}
+
+	// the smallest value with at least percentile% of the values at or below it: ceil(n * p / 100), counted from 1
+	const size_t rank = (sorted_values.size() * percentile + 99) / 100;
+	return sorted_values[std::min(sorted_values.size(), std::max<size_t>(rank, 1)) - 1];
+}
@@ -6,17 +6,79 @@
 
 #include "xrp.h"
 
-#include <cstdarg>
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
+#include <charconv>
 #include <thread>
 #include <vector>
 
+#include "xrp_timing.h"
+
+static const std::set<std::string> internal_extensions = {
+#ifdef XR_KHR_locate_spaces
+	XR_KHR_LOCATE_SPACES_EXTENSION_NAME,
+#endif
+#if defined(XR_USE_TIMESPEC)
+	XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME,
+#elif defined(XR_USE_PLATFORM_WIN32)
+	XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME,
+#endif
+};
+
+// not requested in headless mode
 #ifdef XR_USE_PLATFORM_ANDROID
-static const std::set<std::string> internal_extensions = {XR_KHR_OPENGL_ES_ENABLE_EXTENSION_NAME};
+static const std::set<std::string> graphics_extensions = {
+	XR_KHR_OPENGL_ES_ENABLE_EXTENSION_NAME,
+};
+#else
+static const std::set<std::string> graphics_extensions = {
+	XR_KHR_OPENGL_ENABLE_EXTENSION_NAME,
+	XR_KHR_D3D12_ENABLE_EXTENSION_NAME,
+};
+#endif
+
+bool XrpIsInstanceExtensionSupported(const std::string& extension_name) {
+	uint32_t extension_count = 0;
+	if (XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_count, nullptr))) {
+		XrpLog("failed to enumerate instance extensions");
+		return false;
+	}
+
+	std::vector<XrExtensionProperties> extension_properties(extension_count, {.type = XR_TYPE_EXTENSION_PROPERTIES, .next = nullptr});
+	if (XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, extension_count, &extension_count, extension_properties.data()))) {
+		XrpLog("failed to enumerate instance extensions");
+		return false;
+	}
+
+	for (const auto& available_extension : extension_properties) {
+		if (extension_name == available_extension.extensionName) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool XrpIsHeadlessSupported() {
+	if (!XrpIsInstanceExtensionSupported(XR_MND_HEADLESS_EXTENSION_NAME)) {
+		XrpLog("%s is not supported by the runtime", XR_MND_HEADLESS_EXTENSION_NAME);
+		return false;
+	}
+
+#if defined(XR_USE_TIMESPEC)
+	const char* time_extension_name = XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME;
+#elif defined(XR_USE_PLATFORM_WIN32)
+	const char* time_extension_name = XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME;
 #else
-static const std::set<std::string> internal_extensions = {XR_KHR_OPENGL_ENABLE_EXTENSION_NAME, XR_KHR_D3D12_ENABLE_EXTENSION_NAME};
+	const char* time_extension_name = nullptr;
 #endif
+	if (!time_extension_name || !XrpIsInstanceExtensionSupported(time_extension_name)) {
+		XrpLog("%s is not supported by the runtime, so its current time can't be read",
+			   time_extension_name ? time_extension_name : "converting the system's clock");
+		return false;
+	}
+
+	return true;
+}
 
 bool XrpSetAvailableExtensions(const XrpApp& app, XrpContext& out_context, uint32_t& available_extension_count,
 							  std::vector<std::string>& available_extension_names, uint32_t& app_available_extension_count) {
@@ -29,6 +91,9 @@ bool XrpSetAvailableExtensions(const XrpApp& app, XrpContext& out_context, uint3
 	std::set<std::string> requested_extensions;
 	requested_extensions.insert(app.requested_extensions.begin(), app.requested_extensions.end());
 	requested_extensions.insert(internal_extensions.begin(), internal_extensions.end());
+	if (!app.headless) {
+		requested_extensions.insert(graphics_extensions.begin(), graphics_extensions.end());
+	}
 
 	for (const auto& available_extension : extension_properties) {
 		std::string current_extension_name = available_extension.extensionName;
@@ -57,9 +122,12 @@ bool XrpCreateInstance(const XrpApp& app, XrpContext& out_context) {
 	uint32_t available_extension_count = 0;
 	std::vector<std::string> available_extension_names{};
 	uint32_t app_available_extension_count = 0;
-	if (!XrpSetAvailableExtensions(app, out_context, available_extension_count, available_extension_names, app_available_extension_count)) {
-		XrpLog("failed to get available extensions");
-		return false;
+	{
+		XrpScopedPhase phase("XrpSetAvailableExtensions");
+		if (!XrpSetAvailableExtensions(app, out_context, available_extension_count, available_extension_names, app_available_extension_count)) {
+			XrpLog("failed to get available extensions");
+			return false;
+		}
 	}
 
 	if (app_available_extension_count < app.requested_extensions.size()) {
@@ -89,7 +157,10 @@ bool XrpCreateInstance(const XrpApp& app, XrpContext& out_context) {
 		};
 		app.app_name.copy(instance_create_info.applicationInfo.applicationName, app.app_name.size());
 		app.engine_name.copy(instance_create_info.applicationInfo.engineName, app.engine_name.size());
-		XRP_CHECK_OR_RETURN(out_context, xrCreateInstance(&instance_create_info, &out_context.instance));
+		{
+			XrpScopedPhase phase("xrCreateInstance");
+			XRP_CHECK_OR_RETURN(out_context, xrCreateInstance(&instance_create_info, &out_context.instance));
+		}
 
 		XrInstanceProperties instance_properties = {.type = XR_TYPE_INSTANCE_PROPERTIES, .next = nullptr};
 		XRP_CHECK_OR_RETURN(out_context, xrGetInstanceProperties(out_context.instance, &instance_properties));
@@ -110,7 +181,7 @@ bool XrpCreateSession(XrpContext& out_context) {
 			.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY,
 		};
 
-		XRP_CHECK_OR_RETURN(out_context, xrGetSystem(out_context.instance, &system_get_info, &out_context.system_id));
+		XRP_CHECK_OR_RETURN(out_context, out_context.dispatch.xrGetSystem(out_context.instance, &system_get_info, &out_context.system_id));
 	}
 
 	XrSessionCreateInfo session_create_info = {
@@ -118,8 +189,11 @@ bool XrpCreateSession(XrpContext& out_context) {
 		.systemId = out_context.system_id,
 	};
 
+	if (out_context.headless) {
+		XrpLog("creating headless session");
+	}
 #ifdef XR_USE_PLATFORM_ANDROID
-	if (XrpIsExtensionAvailable(out_context, XR_KHR_OPENGL_ES_ENABLE_EXTENSION_NAME)) {
+	else if (XrpIsExtensionAvailable(out_context, XR_KHR_OPENGL_ES_ENABLE_EXTENSION_NAME)) {
 		XrGraphicsRequirementsOpenGLESKHR reqOpenGLES{
 			.type = XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_ES_KHR,
 		};
@@ -165,7 +239,7 @@ bool XrpCreateSession(XrpContext& out_context) {
 		return false;
 	}
 #else
-	if (XrpIsExtensionAvailable(out_context, XR_KHR_OPENGL_ENABLE_EXTENSION_NAME)) {
+	else if (XrpIsExtensionAvailable(out_context, XR_KHR_OPENGL_ENABLE_EXTENSION_NAME)) {
 		XrGraphicsRequirementsOpenGLKHR reqOpenGL{
 			.type = XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_KHR,
 		};
@@ -197,7 +271,7 @@ bool XrpCreateSession(XrpContext& out_context) {
 	}
 
 #ifdef XR_USE_PLATFORM_WIN32
-	if (XrpIsExtensionAvailable(out_context, XR_KHR_D3D12_ENABLE_EXTENSION_NAME) && !session_create_info.next) {
+	if (!out_context.headless && XrpIsExtensionAvailable(out_context, XR_KHR_D3D12_ENABLE_EXTENSION_NAME) && !session_create_info.next) {
 		PFN_xrGetD3D12GraphicsRequirementsKHR pfnGetD3D12GraphicsRequirementsKHR = nullptr;
 		XRP_CHECK_OR_RETURN(out_context, xrGetInstanceProcAddr(out_context.instance, "xrGetD3D12GraphicsRequirementsKHR",
 															   reinterpret_cast<PFN_xrVoidFunction*>(&pfnGetD3D12GraphicsRequirementsKHR)));
@@ -263,7 +337,7 @@ bool XrpCreateSession(XrpContext& out_context) {
 
 #endif
 
-	XRP_CHECK_OR_RETURN(out_context, xrCreateSession(out_context.instance, &session_create_info, &out_context.session));
+	XRP_CHECK_OR_RETURN(out_context, out_context.dispatch.xrCreateSession(out_context.instance, &session_create_info, &out_context.session));
 
 	{
 		XrReferenceSpaceCreateInfo reference_space_create_info = {
@@ -272,23 +346,127 @@ bool XrpCreateSession(XrpContext& out_context) {
 			.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL,
 			.poseInReferenceSpace = xrp_identity_pose,
 		};
-		XRP_CHECK_OR_RETURN(out_context, xrCreateReferenceSpace(out_context.session, &reference_space_create_info, &out_context.reference_space));
+		XRP_CHECK_OR_RETURN(out_context,
+							out_context.dispatch.xrCreateReferenceSpace(out_context.session, &reference_space_create_info, &out_context.reference_space));
+	}
+
+	return true;
+}
+
+bool XrpLocateSpaces(const XrpContext& context, XrSpace base_space, XrTime time, const std::vector<XrSpace>& spaces,
+					 std::vector<XrSpaceLocation>& out_locations, std::vector<XrSpaceVelocity>* out_velocities) {
+	out_locations.resize(spaces.size());
+	if (out_velocities) {
+		out_velocities->resize(spaces.size());
+	}
+
+#ifdef XR_KHR_locate_spaces
+	if (context.pfn_locate_spaces) {
+		// reused between calls so locating doesn't allocate every frame
+		static thread_local std::vector<XrSpaceLocationDataKHR> location_data;
+		location_data.resize(spaces.size());
+		static thread_local std::vector<XrSpaceVelocityDataKHR> velocity_data;
+		velocity_data.resize(out_velocities ? spaces.size() : 0);
+
+		XrSpaceVelocitiesKHR velocities = {
+			.type = XR_TYPE_SPACE_VELOCITIES_KHR,
+			.next = nullptr,
+			.velocityCount = static_cast<uint32_t>(velocity_data.size()),
+			.velocities = velocity_data.data(),
+		};
+
+		XrSpacesLocateInfoKHR locate_info = {
+			.type = XR_TYPE_SPACES_LOCATE_INFO_KHR,
+			.next = nullptr,
+			.baseSpace = base_space,
+			.time = time,
+			.spaceCount = static_cast<uint32_t>(spaces.size()),
+			.spaces = spaces.data(),
+		};
+		XrSpaceLocationsKHR locations = {
+			.type = XR_TYPE_SPACE_LOCATIONS_KHR,
+			.next = out_velocities ? &velocities : nullptr,
+			.locationCount = static_cast<uint32_t>(location_data.size()),
+			.locations = location_data.data(),
+		};
+		XRP_CHECK_OR_RETURN(context, context.pfn_locate_spaces(context.session, &locate_info, &locations));
+
+		for (size_t i = 0; i < spaces.size(); i++) {
+			out_locations[i] = {
+				.type = XR_TYPE_SPACE_LOCATION,
+				.next = nullptr,
+				.locationFlags = location_data[i].locationFlags,
+				.pose = location_data[i].pose,
+			};
+		}
+
+		for (size_t i = 0; i < velocity_data.size(); i++) {
+			(*out_velocities)[i] = {
+				.type = XR_TYPE_SPACE_VELOCITY,
+				.next = nullptr,
+				.velocityFlags = velocity_data[i].velocityFlags,
+				.linearVelocity = velocity_data[i].linearVelocity,
+				.angularVelocity = velocity_data[i].angularVelocity,
+			};
+		}
+
+		return true;
+	}
+#endif
+
+	for (size_t i = 0; i < spaces.size(); i++) {
+		out_locations[i] = {.type = XR_TYPE_SPACE_LOCATION, .next = nullptr};
+		if (out_velocities) {
+			(*out_velocities)[i] = {.type = XR_TYPE_SPACE_VELOCITY, .next = nullptr};
+			out_locations[i].next = &(*out_velocities)[i];
+		}
+
+		XRP_CHECK_OR_RETURN(context, context.dispatch.xrLocateSpace(spaces[i], base_space, time, &out_locations[i]));
+
+		// the velocities are returned separately, so don't leave a pointer into them behind
+		out_locations[i].next = nullptr;
 	}
 
 	return true;
 }
 
 XrPath XrpStringToXrPath(const XrpContext& context, const std::string& path) {
+	const auto interned_path = context.path_table.paths.find(path);
+	if (interned_path != context.path_table.paths.end()) {
+		return interned_path->second;
+	}
+
 	XrPath xr_path;
-	XRP_CHECK_OR_RETURN(context, xrStringToPath(context.instance, path.c_str(), &xr_path));
+	if (context.instance == XR_NULL_HANDLE) {
+		// without an instance (e.g. when replaying a capture) paths only need to be unique within the context
+		xr_path = static_cast<XrPath>(context.path_table.paths.size() + 1);
+	} else {
+		XRP_CHECK_OR_RETURN(context, context.dispatch.xrStringToPath(context.instance, path.c_str(), &xr_path));
+	}
+
+	context.path_table.paths[path] = xr_path;
+	context.path_table.strings[xr_path] = path;
 
 	return xr_path;
 }
 
 bool XrpXrPathToString(const XrpContext& context, const XrPath path, std::string& out_path) {
+	const auto interned_string = context.path_table.strings.find(path);
+	if (interned_string != context.path_table.strings.end()) {
+		out_path = interned_string->second;
+		return true;
+	}
+
+	// paths are only interned locally when replaying without an instance
+	if (context.instance == XR_NULL_HANDLE) {
+		XrpLog("failed to get string for path %llu without an instance", static_cast<unsigned long long>(path));
+
+		return false;
+	}
+
 	char buffer[XR_MAX_PATH_LENGTH];
 	uint32_t written;
-	if (xrPathToString(context.instance, path, sizeof(buffer), &written, buffer) != XR_SUCCESS) {
+	if (context.dispatch.xrPathToString(context.instance, path, sizeof(buffer), &written, buffer) != XR_SUCCESS) {
 		XrpLog("failed to get string for path");
 
 		return false;
@@ -296,15 +474,92 @@ bool XrpXrPathToString(const XrpContext& context, const XrPath path, std::string
 
 	out_path = buffer;
 
+	context.path_table.paths[out_path] = path;
+	context.path_table.strings[path] = out_path;
+
 	return true;
 }
 
-bool XrpGetInteractionProfileForUserPath(const XrpContext& context, const std::string& user_path, std::string& out_interaction_profile) {
-	const XrPath subaction_path = XrpStringToXrPath(context, user_path);
+static bool XrpQueryInteractionProfile(const XrpContext& context, const XrPath user_path, XrPath& out_interaction_profile) {
 	XrInteractionProfileState interaction_profile_state = {.type = XR_TYPE_INTERACTION_PROFILE_STATE};
-	XRP_CHECK_OR_RETURN(context, xrGetCurrentInteractionProfile(context.session, subaction_path, &interaction_profile_state));
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrGetCurrentInteractionProfile(context.session, user_path, &interaction_profile_state));
+
+	out_interaction_profile = interaction_profile_state.interactionProfile;
 
-	return XrpXrPathToString(context, interaction_profile_state.interactionProfile, out_interaction_profile);
+	// intern the string now, rather than when it is first needed for output
+	std::string interaction_profile_string;
+	if (out_interaction_profile != XR_NULL_PATH) {
+		XrpXrPathToString(context, out_interaction_profile, interaction_profile_string);
+	}
+
+	return true;
+}
+
+static bool XrpRefreshInteractionProfiles(XrpContext& context) {
+	for (auto& interaction_profile : context.interaction_profiles) {
+		if (!XrpQueryInteractionProfile(context, interaction_profile.first, interaction_profile.second)) {
+			return false;
+		}
+
+		std::string user_path_string;
+		std::string interaction_profile_string = "none";
+		XrpXrPathToString(context, interaction_profile.first, user_path_string);
+		if (interaction_profile.second != XR_NULL_PATH) {
+			XrpXrPathToString(context, interaction_profile.second, interaction_profile_string);
+		}
+		XrpLog("interaction profile for %s is now: %s", user_path_string.c_str(), interaction_profile_string.c_str());
+	}
+
+	return true;
+}
+
+bool XrpGetInteractionProfileForUserPath(const XrpContext& context, const XrPath user_path, XrPath& out_interaction_profile) {
+	const auto cached_interaction_profile = context.interaction_profiles.find(user_path);
+	if (cached_interaction_profile != context.interaction_profiles.end()) {
+		out_interaction_profile = cached_interaction_profile->second;
+		return true;
+	}
+
+	if (!XrpQueryInteractionProfile(context, user_path, out_interaction_profile)) {
+		return false;
+	}
+
+	context.interaction_profiles[user_path] = out_interaction_profile;
+
+	return true;
+}
+
+bool XrpGetInteractionProfileForUserPath(const XrpContext& context, const std::string& user_path, std::string& out_interaction_profile) {
+	XrPath interaction_profile;
+	if (!XrpGetInteractionProfileForUserPath(context, XrpStringToXrPath(context, user_path), interaction_profile)) {
+		return false;
+	}
+
+	return XrpXrPathToString(context, interaction_profile, out_interaction_profile);
+}
+
+bool XrpGetCurrentXrTime(const XrpContext& context, XrTime& out_time) {
+#if defined(XR_USE_TIMESPEC)
+	if (context.pfn_convert_timespec_time) {
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		XRP_CHECK_OR_RETURN(context, context.pfn_convert_timespec_time(context.instance, &now, &out_time));
+		return true;
+	}
+#elif defined(XR_USE_PLATFORM_WIN32)
+	if (context.pfn_convert_performance_counter_time) {
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		XRP_CHECK_OR_RETURN(context, context.pfn_convert_performance_counter_time(context.instance, &now, &out_time));
+		return true;
+	}
+#endif
+
+	XrpLog("no way to get the current time from the runtime");
+
+	return false;
 }
 
 #ifdef XR_USE_PLATFORM_ANDROID
@@ -339,11 +594,74 @@ bool XrpInit(const XrpApp& app, XrpContext& out_context) {
 		return false;
 	}
 
-	if (!XrpCreateSession(out_context)) {
-		XrpLog("failed to create xr session");
+	if (!XrpLoadDispatchTable(out_context.instance, out_context.dispatch)) {
+		XrpLog("failed to load openxr functions");
+
 		return false;
 	}
 
+	if (app.headless) {
+		if (!XrpIsExtensionAvailable(out_context, XR_MND_HEADLESS_EXTENSION_NAME)) {
+			XrpLog("headless mode requested, but %s is not available", XR_MND_HEADLESS_EXTENSION_NAME);
+
+			return false;
+		}
+
+		out_context.headless = true;
+	}
+
+#if defined(XR_USE_TIMESPEC)
+	if (XrpIsExtensionAvailable(out_context, XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME)) {
+		XRP_CHECK_OR_RETURN(out_context, xrGetInstanceProcAddr(out_context.instance, "xrConvertTimespecTimeToTimeKHR",
+															   reinterpret_cast<PFN_xrVoidFunction*>(&out_context.pfn_convert_timespec_time)));
+	}
+#elif defined(XR_USE_PLATFORM_WIN32)
+	if (XrpIsExtensionAvailable(out_context, XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME)) {
+		XRP_CHECK_OR_RETURN(out_context, xrGetInstanceProcAddr(out_context.instance, "xrConvertWin32PerformanceCounterToTimeKHR",
+															   reinterpret_cast<PFN_xrVoidFunction*>(&out_context.pfn_convert_performance_counter_time)));
+	}
+#endif
+
+	// the instance was created without a graphics extension, so there's no falling back to a normal session from here
+#if defined(XR_USE_TIMESPEC)
+	const bool has_current_time = out_context.pfn_convert_timespec_time != nullptr;
+#elif defined(XR_USE_PLATFORM_WIN32)
+	const bool has_current_time = out_context.pfn_convert_performance_counter_time != nullptr;
+#else
+	const bool has_current_time = false;
+#endif
+	if (out_context.headless && !has_current_time) {
+		XrpLog("headless mode requested, but the runtime's current time can't be read");
+
+		return false;
+	}
+
+#ifdef XR_KHR_locate_spaces
+	{
+		PFN_xrVoidFunction pfn_locate_spaces = nullptr;
+#ifdef XR_VERSION_1_1
+		// instances are created with XR_CURRENT_API_VERSION, so xrLocateSpaces is core when the headers are 1.1 or newer
+		if (xrGetInstanceProcAddr(out_context.instance, "xrLocateSpaces", &pfn_locate_spaces) != XR_SUCCESS) {
+			pfn_locate_spaces = nullptr;
+		}
+#endif
+		if (!pfn_locate_spaces && XrpIsExtensionAvailable(out_context, XR_KHR_LOCATE_SPACES_EXTENSION_NAME)) {
+			XRP_CHECK_OR_RETURN(out_context, xrGetInstanceProcAddr(out_context.instance, "xrLocateSpacesKHR", &pfn_locate_spaces));
+		}
+
+		out_context.pfn_locate_spaces = XrpInstrumentLocateSpaces(pfn_locate_spaces);
+		XrpLog("locating spaces %s", out_context.pfn_locate_spaces ? "in batches" : "individually");
+	}
+#endif
+
+	{
+		XrpScopedPhase phase("XrpCreateSession");
+		if (!XrpCreateSession(out_context)) {
+			XrpLog("failed to create xr session");
+			return false;
+		}
+	}
+
 	XrpLog("openxr initialized successfully");
 
 	return true;
@@ -351,12 +669,44 @@ bool XrpInit(const XrpApp& app, XrpContext& out_context) {
 
 bool XrpEndSession(const XrpContext& context) {
 	XrpLog("ending xr session");
-	XRP_CHECK_OR_RETURN(context, xrEndSession(context.session));
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrEndSession(context.session));
 	return true;
 }
 
 static bool exit_requested = false;
 
+static double XrpDurationToMilliseconds(const std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static void XrpLogFrameStatistics(const XrpContext& context) {
+	static const char* const frame_pacing_names[] = {"wait_frame", "fixed_sleep", "display_period"};
+
+	const XrpFrameStatistics& statistics = context.frame_statistics;
+	XrpLog("frame pacing: %s, %llu frames, %llu idle polls", frame_pacing_names[context.frame_pacing], (unsigned long long)statistics.frame_count,
+		   (unsigned long long)statistics.idle_polls);
+
+	const std::pair<const char*, const RunningStatistics*> phases[] = {
+		{"xrWaitFrame", &statistics.wait_frame}, {"xrBeginFrame", &statistics.begin_frame}, {"callback", &statistics.callback},
+		{"xrEndFrame", &statistics.end_frame},	 {"sleep", &statistics.sleep},
+	};
+	for (const auto& phase : phases) {
+		XrpLog("  %s: mean %.3f ms, stddev %.3f ms, max %.3f ms", phase.first, phase.second->mean, phase.second->StandardDeviation(),
+			   phase.second->count > 0 ? phase.second->max : 0.0);
+	}
+}
+
+// A callback that fails ends the session, e.g. rather than sampling item sets that failed to initialize
+static void XrpDispatchEvent(const XrpContext& context, const std::function<bool(XrpEvent, const XrpEventData&)>& event_callback, XrpEvent event,
+							 const XrpEventData& event_data) {
+	if (event_callback(event, event_data) || exit_requested) {
+		return;
+	}
+
+	XrpLog("event callback failed, exiting session");
+	XrpRequestExitSession(context);
+}
+
 bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, const XrpEventData&)>& event_callback) {
 	if (context.session == XR_NULL_HANDLE) {
 		XrpLog("session is invalid");
@@ -366,17 +716,25 @@ bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, con
 	bool session_running = false;
 	bool run_framecycle = false;
 
-	XrSessionState current_session_state;
+	XrSessionState current_session_state = XR_SESSION_STATE_UNKNOWN;
+
+	static constexpr std::chrono::microseconds idle_poll_min_interval(1000);
+	std::chrono::microseconds idle_poll_interval = idle_poll_min_interval;
 
 	// Main loop
 	while (!should_exit) {
 		XrEventDataBuffer runtime_event = {.type = XR_TYPE_EVENT_DATA_BUFFER};
 
-		XrResult result = xrPollEvent(context.instance, &runtime_event);
+		XrResult result = context.dispatch.xrPollEvent(context.instance, &runtime_event);
+		if (result == XR_SUCCESS) {
+			idle_poll_interval = idle_poll_min_interval;
+		}
+
 		while (result == XR_SUCCESS) {
 			switch (runtime_event.type) {
 				case XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING: {
 					XrpLog("runtime state updated: %s", "XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING");
+					event_callback(XRP_EVENT_SESSION_ENDING, {.session_state = current_session_state});
 					should_exit = true;
 					break;
 				}
@@ -403,24 +761,25 @@ bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, con
 								.type = XR_TYPE_SESSION_BEGIN_INFO,
 								.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
 							};
-							XRP_CHECK_OR_RETURN(context, xrBeginSession(context.session, &session_begin_info));
+							XRP_CHECK_OR_RETURN(context, context.dispatch.xrBeginSession(context.session, &session_begin_info));
 
 							XrpLog("session has begun");
 
 							session_running = true;
 							run_framecycle = true;
 
-							event_callback(XRP_EVENT_SESSION_READY, {.session_state = current_session_state});
+							XrpDispatchEvent(context, event_callback, XRP_EVENT_SESSION_READY, {.session_state = current_session_state});
 							break;
 						};
 
 						case XR_SESSION_STATE_FOCUSED: {
-							event_callback(XRP_EVENT_SESSION_FOCUSED, {.session_state = current_session_state});
+							XrpDispatchEvent(context, event_callback, XRP_EVENT_SESSION_FOCUSED, {.session_state = current_session_state});
 							break;
 						}
 
 						case XR_SESSION_STATE_STOPPING: {
 							run_framecycle = false;
+							event_callback(XRP_EVENT_SESSION_ENDING, {.session_state = current_session_state});
 							XrpEndSession(context);
 
 							break;
@@ -428,7 +787,8 @@ bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, con
 
 						case XR_SESSION_STATE_LOSS_PENDING:
 						case XR_SESSION_STATE_EXITING: {
-							XRP_CHECK_OR_RETURN(context, xrDestroySession(context.session));
+							event_callback(XRP_EVENT_SESSION_ENDING, {.session_state = current_session_state});
+							XRP_CHECK_OR_RETURN(context, context.dispatch.xrDestroySession(context.session));
 
 							should_exit = true;
 							run_framecycle = false;
@@ -441,15 +801,64 @@ bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, con
 
 					break;
 				}
+				case XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED: {
+					XrpLog("runtime state updated: %s", "XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED");
+					XrpRefreshInteractionProfiles(context);
+					break;
+				}
 				default: {
 					break;
 				}
 			}
 
 			runtime_event.type = XR_TYPE_EVENT_DATA_BUFFER;
-			result = xrPollEvent(context.instance, &runtime_event);
+			result = context.dispatch.xrPollEvent(context.instance, &runtime_event);
 		}
-		if (!run_framecycle || exit_requested) continue;
+		if (!run_framecycle || exit_requested) {
+			// nothing to do until the runtime sends another event, so back off rather than spinning on xrPollEvent
+			if (!should_exit) {
+				context.frame_statistics.idle_polls++;
+
+				std::this_thread::sleep_for(idle_poll_interval);
+				idle_poll_interval = std::min(idle_poll_interval * 2, std::max(context.idle_poll_max_interval, idle_poll_min_interval));
+			}
+			continue;
+		}
+
+		if (context.headless) {
+			// headless sessions don't have a frame loop, so make up the frame state from the runtime's clock
+			const auto callback_start = std::chrono::steady_clock::now();
+
+			// end the session through STOPPING and EXITING as usual, rather than leaving it running
+			XrTime now;
+			if (!XrpGetCurrentXrTime(context, now)) {
+				XrpLog("failed to get the current time for a headless frame, exiting session");
+				XrpRequestExitSession(context);
+				continue;
+			}
+
+			context.current_frame_state = {
+				.type = XR_TYPE_FRAME_STATE,
+				.next = nullptr,
+				.predictedDisplayTime = now,
+				.predictedDisplayPeriod = std::chrono::duration_cast<std::chrono::nanoseconds>(context.headless_frame_period).count(),
+				.shouldRender = false,
+			};
+
+			XrpDispatchEvent(context, event_callback, XRP_EVENT_DO_FRAME, {.session_state = current_session_state});
+
+			const auto callback_end = std::chrono::steady_clock::now();
+
+			std::this_thread::sleep_until(callback_start + context.headless_frame_period);
+
+			XrpFrameStatistics& statistics = context.frame_statistics;
+			statistics.frame_count++;
+			statistics.callback.Add(XrpDurationToMilliseconds(callback_end - callback_start));
+			statistics.sleep.Add(XrpDurationToMilliseconds(std::chrono::steady_clock::now() - callback_end));
+			continue;
+		}
+
+		const auto wait_start = std::chrono::steady_clock::now();
 
 		XrFrameState frame_state = {
 			.type = XR_TYPE_FRAME_STATE,
@@ -457,13 +866,19 @@ bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, con
 			.shouldRender = true,
 		};
 		XrFrameWaitInfo frame_wait_info = {.type = XR_TYPE_FRAME_WAIT_INFO, .next = nullptr};
-		XRP_CHECK_OR_RETURN(context, xrWaitFrame(context.session, &frame_wait_info, &frame_state));
+		XRP_CHECK_OR_RETURN(context, context.dispatch.xrWaitFrame(context.session, &frame_wait_info, &frame_state));
 		context.current_frame_state = frame_state;
 
+		const auto wait_end = std::chrono::steady_clock::now();
+
 		XrFrameBeginInfo frame_begin_info = {.type = XR_TYPE_FRAME_BEGIN_INFO, .next = nullptr};
-		XRP_CHECK_OR_RETURN(context, xrBeginFrame(context.session, &frame_begin_info));
+		XRP_CHECK_OR_RETURN(context, context.dispatch.xrBeginFrame(context.session, &frame_begin_info));
+
+		const auto begin_end = std::chrono::steady_clock::now();
 
-		event_callback(XRP_EVENT_DO_FRAME, {.session_state = current_session_state});
+		XrpDispatchEvent(context, event_callback, XRP_EVENT_DO_FRAME, {.session_state = current_session_state});
+
+		const auto callback_end = std::chrono::steady_clock::now();
 
 		XrFrameEndInfo frame_end_info = {
 			.type = XR_TYPE_FRAME_END_INFO,
@@ -471,50 +886,93 @@ bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, con
 			.displayTime = frame_state.predictedDisplayTime,
 			.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE,
 		};
-		XRP_CHECK_OR_RETURN(context, xrEndFrame(context.session, &frame_end_info));
+		XRP_CHECK_OR_RETURN(context, context.dispatch.xrEndFrame(context.session, &frame_end_info));
+
+		const auto end_end = std::chrono::steady_clock::now();
+
+		switch (context.frame_pacing) {
+			case XRP_FRAME_PACING_WAIT_FRAME:
+				break;
+			case XRP_FRAME_PACING_FIXED_SLEEP:
+				std::this_thread::sleep_for(context.frame_pacing_sleep);
+				break;
+			case XRP_FRAME_PACING_DISPLAY_PERIOD: {
+				// xrWaitFrame returns about once per display period, so there is no point calling it again much before then
+				const auto deadline = wait_end + std::chrono::nanoseconds(frame_state.predictedDisplayPeriod) - context.frame_pacing_margin;
+				if (deadline > end_end) {
+					std::this_thread::sleep_until(deadline);
+				}
+				break;
+			}
+		}
+
+		const auto sleep_end = std::chrono::steady_clock::now();
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		if (XrpIsTracingEnabled()) {
+			XrpRecordTraceEvent("frame pacing", end_end, sleep_end);
+			XrpRecordTraceEvent("frame", wait_start, sleep_end);
+		}
+
+		XrpFrameStatistics& statistics = context.frame_statistics;
+		statistics.frame_count++;
+		statistics.wait_frame.Add(XrpDurationToMilliseconds(wait_end - wait_start));
+		statistics.begin_frame.Add(XrpDurationToMilliseconds(begin_end - wait_end));
+		statistics.callback.Add(XrpDurationToMilliseconds(callback_end - begin_end));
+		statistics.end_frame.Add(XrpDurationToMilliseconds(end_end - callback_end));
+		statistics.sleep.Add(XrpDurationToMilliseconds(sleep_end - end_end));
 	}
 
+	XrpLogFrameStatistics(context);
+
 	return true;
 }
 
 bool XrpRequestExitSession(const XrpContext& context) {
 	XrpLog("requesting xr session exit");
 	exit_requested = true;
-	XRP_CHECK_OR_RETURN(context, xrRequestExitSession(context.session));
+	XRP_CHECK_OR_RETURN(context, context.dispatch.xrRequestExitSession(context.session));
 
 	return true;
 }
 
 bool XrpDestroy(XrpContext& context) {
+	if (!context.latency_summary_path.empty()) {
+		XrpWriteLatencySummary(context.latency_summary_path);
+	}
+
+	// anything logged so far would be lost if destroying the instance fails
+	XrpFlushLog();
+
 	XRP_CHECK_OR_RETURN(context, xrDestroyInstance(context.instance));
 
+	XrpFlushLog();
+
 	return true;
 }
 
-std::string XrpRoundFloatToString(float value, int precision) {
-	std::stringstream stream;
-	stream << std::fixed << std::setprecision(precision) << value;
+size_t XrpFormatFloat(float value, int precision, char* buffer, size_t buffer_size) {
+	if (buffer_size == 0) {
+		return 0;
+	}
 
-	return stream.str();
-}
+	// leave space for the null terminator
+	char* const buffer_end = buffer + buffer_size - 1;
+	const std::to_chars_result result = precision == XRP_FLOAT_PRECISION_SHORTEST
+											? std::to_chars(buffer, buffer_end, value)
+											: std::to_chars(buffer, buffer_end, value, std::chars_format::fixed, precision);
+	if (result.ec != std::errc()) {
+		buffer[0] = '\0';
+		return 0;
+	}
 
-#if !defined(WIN32)
-#define vsnprintf_s vsnprintf
-#endif
-void XrpLog(const char* format, ...) {
-	va_list args;
-	va_start(args, format);
+	*result.ptr = '\0';
 
-#ifdef XR_USE_PLATFORM_ANDROID
-	__android_log_vprint(ANDROID_LOG_INFO, "danwillm", format, args);
-#else
-	char buf[1024];
-	vsnprintf_s(buf, sizeof(buf), format, args);
+	return result.ptr - buffer;
+}
 
-	std::cout << buf << std::endl;
-#endif
+std::string XrpRoundFloatToString(float value, int precision) {
+	char buffer[XRP_FLOAT_STRING_SIZE];
+	const size_t length = XrpFormatFloat(value, precision, buffer, sizeof(buffer));
 
-	va_end(args);
-}
\ No newline at end of file
+	return {buffer, length};
+}
@@ -7,11 +7,14 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -56,6 +59,14 @@
 #define XR_USE_GRAPHICS_API_OPENGL_ES
 #endif
 
+// XR_KHR_convert_timespec_time is used to get the current XrTime without a frame loop
+#if defined(XR_USE_PLATFORM_ANDROID) || defined(XR_USE_PLATFORM_XLIB)
+#include <time.h>
+#ifndef XR_USE_TIMESPEC
+#define XR_USE_TIMESPEC
+#endif
+#endif
+
 #ifdef XR_USE_PLATFORM_WIN32
 #define XR_USE_GRAPHICS_API_OPENGL
 #define XR_USE_GRAPHICS_API_D3D12
@@ -67,18 +78,33 @@
 
 #include "openxr/openxr.h"
 #include "openxr/openxr_platform.h"
-
-#define XRP_CHECK_OR_RETURN(context, func)                                                                                    \
-	do {                                                                                                                      \
-		XrResult xrpresult = func;                                                                                            \
-		if (!XR_UNQUALIFIED_SUCCESS(xrpresult)) {                                                                             \
-			char xrperr[XR_MAX_RESULT_STRING_SIZE];                                                                           \
-			xrResultToString(context.instance, xrpresult, xrperr);                                                            \
-			std::cout << __FILE__ << ": " << __LINE__ << " - Failed to call " << #func << ". Error: " << xrperr << std::endl; \
-			return false;                                                                                                     \
-		}                                                                                                                     \
+#include "util/util_statistics.h"
+#include "xrp_dispatch.h"
+#include "xrp_trace.h"
+
+#define XRP_CHECK_OR_RETURN(context, func)                                                                                  \
+	do {                                                                                                                    \
+		static constexpr std::string_view xrpcallname = XrpGetTraceCallName(#func);                                         \
+		std::chrono::steady_clock::time_point xrpcallstart;                                                                 \
+		if (!xrpcallname.empty() && XrpIsTracingEnabled()) xrpcallstart = std::chrono::steady_clock::now();                 \
+		XrResult xrpresult = func;                                                                                          \
+		if (!xrpcallname.empty() && XrpIsTracingEnabled())                                                                  \
+			XrpRecordTraceEvent(xrpcallname, xrpcallstart, std::chrono::steady_clock::now());                               \
+		if (!XR_UNQUALIFIED_SUCCESS(xrpresult)) {                                                                           \
+			char xrperr[XR_MAX_RESULT_STRING_SIZE];                                                                         \
+			xrResultToString(context.instance, xrpresult, xrperr);                                                          \
+			XrpLogMessage(XRP_LOG_LEVEL_ERROR, "%s: %i - Failed to call %s. Error: %s", __FILE__, __LINE__, #func, xrperr); \
+			return false;                                                                                                   \
+		}                                                                                                                   \
 	} while (false)
 
+enum XrpLogLevel {
+	XRP_LOG_LEVEL_DEBUG,
+	XRP_LOG_LEVEL_INFO,
+	XRP_LOG_LEVEL_WARNING,
+	XRP_LOG_LEVEL_ERROR,
+};
+
 static const XrPosef xrp_identity_pose = {
 	.orientation = {0, 0, 0, 1.0},
 	.position = {0, 0, 0},
@@ -88,6 +114,8 @@ enum XrpEvent {
 	XRP_EVENT_SESSION_READY,
 	XRP_EVENT_SESSION_FOCUSED,
 	XRP_EVENT_DO_FRAME,
+	// the session is about to be ended or destroyed, so anything still using it (e.g. another thread) must stop
+	XRP_EVENT_SESSION_ENDING,
 };
 
 struct XrpEventData {
@@ -102,22 +130,95 @@ struct XrpApp {
 	uint32_t engine_version;
 
 	std::set<std::string> requested_extensions;
+
+	// create the session without a graphics binding, using XR_MND_headless. The app must request the extension
+	bool headless = false;
+};
+
+enum XrpFramePacing {
+	// xrWaitFrame alone throttles the frame loop
+	XRP_FRAME_PACING_WAIT_FRAME,
+	// sleep for frame_pacing_sleep after xrEndFrame
+	XRP_FRAME_PACING_FIXED_SLEEP,
+	// sleep until frame_pacing_margin before the next frame is predicted to be ready, based on predictedDisplayPeriod
+	XRP_FRAME_PACING_DISPLAY_PERIOD,
+};
+
+// Durations of each part of the frame loop, in milliseconds
+struct XrpFrameStatistics {
+	uint64_t frame_count = 0;
+	// iterations of the loop that polled events without running a frame
+	uint64_t idle_polls = 0;
+
+	RunningStatistics wait_frame;
+	RunningStatistics begin_frame;
+	RunningStatistics callback;
+	RunningStatistics end_frame;
+	RunningStatistics sleep;
 };
 
 struct XrpExtension {
 	bool available = false;
 };
 
+// Paths never change for the lifetime of an instance, so each one is only converted by the runtime once
+struct XrpPathTable {
+	std::unordered_map<std::string, XrPath> paths;
+	std::unordered_map<XrPath, std::string> strings;
+};
+
 struct XrpContext {
-	XrInstance instance;
-	XrSession session;
+	// XR_NULL_HANDLE until XrpInit, and when working offline
+	XrInstance instance = XR_NULL_HANDLE;
+	XrSession session = XR_NULL_HANDLE;
 	XrSystemId system_id;
 
 	XrInstanceProperties instance_properties;
 	XrSpace reference_space;
 	XrFrameState current_frame_state;
 
+	XrpFramePacing frame_pacing = XRP_FRAME_PACING_WAIT_FRAME;
+	std::chrono::microseconds frame_pacing_sleep{1000};
+	std::chrono::microseconds frame_pacing_margin{2000};
+
+	// while the frame cycle isn't running, the wait between event polls doubles from 1 ms up to this
+	std::chrono::microseconds idle_poll_max_interval{100000};
+
+	XrpFrameStatistics frame_statistics;
+
+	// the session has no graphics binding, so xrWaitFrame, xrBeginFrame and xrEndFrame are not called
+	bool headless = false;
+	// interval between frame callbacks in headless mode
+	std::chrono::microseconds headless_frame_period{11111};
+
 	std::map<std::string, XrpExtension> extensions;
+
+	// instrumented OpenXR functions, loaded once the instance is created
+	XrpDispatchTable dispatch;
+	// if set, per function call latencies are written here by XrpDestroy
+	std::string latency_summary_path;
+
+	// action spaces created by item sets, by binding path (e.g. /user/hand/left/input/grip/pose), so other item sets can locate
+	// relative to them
+	std::unordered_map<std::string, XrSpace> action_spaces;
+
+	// interned paths, filled in by XrpStringToXrPath and XrpXrPathToString
+	mutable XrpPathTable path_table;
+
+	// top level user path -> current interaction profile. Entries are added the first time a user path is queried, and are only
+	// refreshed from the runtime when XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED is received
+	mutable std::unordered_map<XrPath, XrPath> interaction_profiles;
+
+#if defined(XR_USE_TIMESPEC)
+	PFN_xrConvertTimespecTimeToTimeKHR pfn_convert_timespec_time = nullptr;
+#elif defined(XR_USE_PLATFORM_WIN32)
+	PFN_xrConvertWin32PerformanceCounterToTimeKHR pfn_convert_performance_counter_time = nullptr;
+#endif
+
+#ifdef XR_KHR_locate_spaces
+	// xrLocateSpaces from OpenXR 1.1, or xrLocateSpacesKHR. null if neither is available
+	PFN_xrLocateSpacesKHR pfn_locate_spaces = nullptr;
+#endif
 };
 
 struct XrpEulerAngles {
@@ -130,17 +231,40 @@ XrPath XrpStringToXrPath(const XrpContext& context, const std::string& path);
 bool XrpXrPathToString(const XrpContext& context, XrPath path, std::string& out_path);
 
 bool XrpGetInteractionProfileForUserPath(const XrpContext& context, const std::string& user_path, std::string& out_interaction_profile);
+bool XrpGetInteractionProfileForUserPath(const XrpContext& context, XrPath user_path, XrPath& out_interaction_profile);
 
 bool XrpIsExtensionAvailable(const XrpContext& context, const std::string& extension_name);
 
+// whether the runtime offers an instance extension. Can be called before XrpInit
+bool XrpIsInstanceExtensionSupported(const std::string& extension_name);
+
+// whether the runtime can run headless sessions: XR_MND_headless, and converting the system's clock to the runtime's, as headless
+// frames are timed with the runtime's current time. Logs what is missing. Can be called before XrpInit
+bool XrpIsHeadlessSupported();
+
+// the current time of the runtime's clock
+bool XrpGetCurrentXrTime(const XrpContext& context, XrTime& out_time);
+
+// Locates all spaces relative to base_space. Uses a single xrLocateSpaces call when available, otherwise calls xrLocateSpace for each space.
+// If out_velocities is set, the velocity of every space is returned from the same call.
+bool XrpLocateSpaces(const XrpContext& context, XrSpace base_space, XrTime time, const std::vector<XrSpace>& spaces,
+					 std::vector<XrSpaceLocation>& out_locations, std::vector<XrSpaceVelocity>* out_velocities = nullptr);
+
 bool XrpInit(const XrpApp& app, XrpContext& out_context);
+// If event_callback returns false, e.g. as an item set failed to initialize, the session is exited
 bool XrpRunFrameLoop(XrpContext& context, const std::function<bool(XrpEvent, const XrpEventData&)>& event_callback);
 
 bool XrpRequestExitSession(const XrpContext& context);
 
 bool XrpDestroy(XrpContext& context);
 
+// Messages are formatted on the calling thread, queued without locking and written by a background thread.
+// Identical messages repeated from the same thread within a second are collapsed into a count.
 void XrpLog(const char* format, ...);
+void XrpLogMessage(XrpLogLevel level, const char* format, ...);
+void XrpSetLogLevel(XrpLogLevel level);
+// Blocks until every message queued before the call has been written
+void XrpFlushLog();
 
 static bool XrpCompareFloat(float x, float y, float tolerance = 0.01f) {
 	if (fabs(x - y) < tolerance) {
@@ -179,6 +303,38 @@ static void StandardizeXrQuaternion(XrQuaternionf& q) {
 	q.z = -q.z;
 }
 
+// orientation_mean is w, x, y, z. The component-wise mean of unit quaternions is not unit length, so it is normalized
+static XrPosef XrpMakeMeanPose(const double (&orientation_mean)[4], const double (&position_mean)[3]) {
+	XrPosef pose = {
+		.orientation =
+			{
+				.x = static_cast<float>(orientation_mean[1]),
+				.y = static_cast<float>(orientation_mean[2]),
+				.z = static_cast<float>(orientation_mean[3]),
+				.w = static_cast<float>(orientation_mean[0]),
+			},
+		.position =
+			{
+				.x = static_cast<float>(position_mean[0]),
+				.y = static_cast<float>(position_mean[1]),
+				.z = static_cast<float>(position_mean[2]),
+			},
+	};
+
+	const float length = std::sqrt(pose.orientation.w * pose.orientation.w + pose.orientation.x * pose.orientation.x +
+								   pose.orientation.y * pose.orientation.y + pose.orientation.z * pose.orientation.z);
+	if (length > 0.f) {
+		pose.orientation.w /= length;
+		pose.orientation.x /= length;
+		pose.orientation.y /= length;
+		pose.orientation.z /= length;
+	}
+
+	StandardizeXrQuaternion(pose.orientation);
+
+	return pose;
+}
+
 static bool operator!(const XrQuaternionf& q) { return q.w == 0.f && q.x == 0.f && q.y == 0.f && q.z == 0.f; }
 
 static bool operator==(const XrQuaternionf& q1, const XrQuaternionf& q2) {
@@ -205,8 +361,26 @@ static XrVector3f operator-(const XrVector3f& vec1, const XrVector3f& vec2) {
 	};
 }
 
+// Transforms pose, located in the same space as base, to be relative to base
+static XrPosef XrpGetRelativePose(const XrPosef& base, const XrPosef& pose) {
+	const XrQuaternionf base_inverse = -base.orientation;
+
+	return {
+		.orientation = base_inverse * pose.orientation,
+		.position = (pose.position - base.position) * base_inverse,
+	};
+}
+
 static bool operator==(const XrVector3f& vec1, const XrVector3f& vec2) {
 	return XrpCompareFloat(vec1.x, vec2.x) && XrpCompareFloat(vec1.y, vec2.y) && XrpCompareFloat(vec1.z, vec2.z);
 }
 
+// large enough for any finite float in fixed notation with up to 9 decimal places
+static constexpr size_t XRP_FLOAT_STRING_SIZE = 64;
+static constexpr int XRP_FLOAT_PRECISION_SHORTEST = -1;
+
+// Writes value into buffer with a fixed number of decimal places, or the shortest representation that round trips when precision is
+// XRP_FLOAT_PRECISION_SHORTEST. buffer is always null terminated. Returns the length of the string, or 0 if it did not fit.
+size_t XrpFormatFloat(float value, int precision, char* buffer, size_t buffer_size);
+
 std::string XrpRoundFloatToString(float value, int precision);
\ No newline at end of file
@@ -0,0 +1,173 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "xrp_dispatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+
+#include "xrp.h"
+
+// Log-linear buckets, like HdrHistogram: each power of two is split into xrp_latency_sub_buckets linear buckets, so every
+// bucket is within 1/xrp_latency_sub_buckets of its value. Covers 1 ns to ~68 s, recording is wait free.
+static constexpr int xrp_latency_sub_bucket_bits = 3;
+static constexpr uint64_t xrp_latency_sub_buckets = 1 << xrp_latency_sub_bucket_bits;
+static constexpr int xrp_latency_max_bits = 36;
+static constexpr size_t xrp_latency_bucket_count = (xrp_latency_max_bits - xrp_latency_sub_bucket_bits + 1) * xrp_latency_sub_buckets;
+
+class XrpLatencyHistogram {
+   public:
+	void Record(uint64_t nanoseconds) {
+		buckets_[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t max = max_.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+		}
+	}
+
+	uint64_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+
+	uint64_t GetMax() const { return max_.load(std::memory_order_relaxed); }
+
+	// upper bound of the bucket the percentile falls in
+	uint64_t GetPercentile(double percentile) const {
+		const uint64_t count = GetCount();
+		if (count == 0) {
+			return 0;
+		}
+
+		const uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count) + 0.5), 1);
+
+		uint64_t cumulative = 0;
+		for (size_t i = 0; i < xrp_latency_bucket_count; i++) {
+			cumulative += buckets_[i].load(std::memory_order_relaxed);
+			if (cumulative >= target) {
+				return std::min(GetBucketUpperBound(i), GetMax());
+			}
+		}
+
+		return GetMax();
+	}
+
+   private:
+	static size_t GetBucket(uint64_t value) {
+		if (value < xrp_latency_sub_buckets) {
+			return static_cast<size_t>(value);
+		}
+
+		const int magnitude = std::bit_width(value) - 1;
+		if (magnitude >= xrp_latency_max_bits) {
+			return xrp_latency_bucket_count - 1;
+		}
+
+		const int shift = magnitude - xrp_latency_sub_bucket_bits;
+		const uint64_t sub_bucket = (value >> shift) & (xrp_latency_sub_buckets - 1);
+		return static_cast<size_t>(shift + 1) * xrp_latency_sub_buckets + sub_bucket;
+	}
+
+	static uint64_t GetBucketUpperBound(size_t bucket) {
+		if (bucket < xrp_latency_sub_buckets) {
+			return bucket;
+		}
+
+		const int shift = static_cast<int>(bucket / xrp_latency_sub_buckets) - 1;
+		const uint64_t sub_bucket = bucket % xrp_latency_sub_buckets;
+		return ((xrp_latency_sub_buckets + sub_bucket + 1) << shift) - 1;
+	}
+
+	std::atomic<uint64_t> buckets_[xrp_latency_bucket_count] = {};
+	std::atomic<uint64_t> count_{0};
+	std::atomic<uint64_t> max_{0};
+};
+
+static const char* const xrp_dispatch_function_names[] = {
+#define XRP_DISPATCH_NAME(name) #name,
+	XRP_DISPATCH_FUNCTIONS(XRP_DISPATCH_NAME)
+#undef XRP_DISPATCH_NAME
+};
+
+#define XRP_DISPATCH_COUNT(name) +1
+static constexpr size_t xrp_dispatch_core_function_count = 0 XRP_DISPATCH_CORE_FUNCTIONS(XRP_DISPATCH_COUNT);
+#undef XRP_DISPATCH_COUNT
+
+// the runtime's own functions, called by the instrumented wrappers
+static PFN_xrVoidFunction xrp_runtime_functions[XRP_DISPATCH_FUNCTION_COUNT] = {};
+static XrpLatencyHistogram xrp_latency_histograms[XRP_DISPATCH_FUNCTION_COUNT];
+
+template <XrpDispatchFunction function, typename Pfn>
+struct XrpInstrumentedFunction;
+
+template <XrpDispatchFunction function, typename... Args>
+struct XrpInstrumentedFunction<function, XrResult(XRAPI_PTR*)(Args...)> {
+	static XRAPI_ATTR XrResult XRAPI_CALL Call(Args... args) {
+		const auto start = std::chrono::steady_clock::now();
+		const XrResult result = reinterpret_cast<XrResult(XRAPI_PTR*)(Args...)>(xrp_runtime_functions[function])(args...);
+		const auto end = std::chrono::steady_clock::now();
+
+		xrp_latency_histograms[function].Record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+		return result;
+	}
+};
+
+bool XrpLoadDispatchTable(XrInstance instance, XrpDispatchTable& out_table) {
+#define XRP_DISPATCH_LOAD(name)                                                                                 \
+	if (xrGetInstanceProcAddr(instance, #name, &xrp_runtime_functions[XRP_DISPATCH_##name]) == XR_SUCCESS) { \
+		out_table.name = &XrpInstrumentedFunction<XRP_DISPATCH_##name, PFN_##name>::Call;                      \
+	} else {                                                                                                    \
+		xrp_runtime_functions[XRP_DISPATCH_##name] = nullptr;                                                   \
+	}
+
+	XRP_DISPATCH_FUNCTIONS(XRP_DISPATCH_LOAD)
+#undef XRP_DISPATCH_LOAD
+
+	// core functions come first in the table, and must be present
+	for (size_t i = 0; i < xrp_dispatch_core_function_count; i++) {
+		if (!xrp_runtime_functions[i]) {
+			XrpLog("failed to load %s", xrp_dispatch_function_names[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#ifdef XR_KHR_locate_spaces
+PFN_xrLocateSpacesKHR XrpInstrumentLocateSpaces(PFN_xrVoidFunction locate_spaces) {
+	xrp_runtime_functions[XRP_DISPATCH_xrLocateSpacesKHR] = locate_spaces;
+	return locate_spaces ? &XrpInstrumentedFunction<XRP_DISPATCH_xrLocateSpacesKHR, PFN_xrLocateSpacesKHR>::Call : nullptr;
+}
+#endif
+
+bool XrpWriteLatencySummary(const std::string& file_name) {
+	FILE* file = fopen(file_name.c_str(), "w");
+	if (!file) {
+		XrpLog("failed to open latency summary: %s", file_name.c_str());
+		return false;
+	}
+
+	fputs("function,calls,p50_us,p99_us,max_us\n", file);
+	for (size_t i = 0; i < XRP_DISPATCH_FUNCTION_COUNT; i++) {
+		const XrpLatencyHistogram& histogram = xrp_latency_histograms[i];
+		if (histogram.GetCount() == 0) {
+			continue;
+		}
+
+		fprintf(file, "%s,%llu,%.3f,%.3f,%.3f\n", xrp_dispatch_function_names[i], static_cast<unsigned long long>(histogram.GetCount()),
+				histogram.GetPercentile(50.0) / 1000.0, histogram.GetPercentile(99.0) / 1000.0, histogram.GetMax() / 1000.0);
+	}
+
+	const bool success = fclose(file) == 0;
+	if (!success) {
+		XrpLog("failed to write latency summary: %s", file_name.c_str());
+	}
+
+	return success;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <string>
+
+#include "openxr/openxr.h"
+// vendor extensions that aren't necessarily in the OpenXR SDK headers yet
+#include "openxr/fb_body_tracking.h"
+#include "openxr/fb_face_tracking.h"
+
+// OpenXR functions that are called through XrpContext::dispatch. Every call is timed into a latency histogram per function.
+// Functions called before the instance exists, and from destructors without a context, are called directly instead.
+#define XRP_DISPATCH_CORE_FUNCTIONS(X)     \
+	X(xrPollEvent)                         \
+	X(xrGetSystem)                         \
+	X(xrCreateSession)                     \
+	X(xrDestroySession)                    \
+	X(xrBeginSession)                      \
+	X(xrEndSession)                        \
+	X(xrRequestExitSession)                \
+	X(xrWaitFrame)                         \
+	X(xrBeginFrame)                        \
+	X(xrEndFrame)                          \
+	X(xrStringToPath)                      \
+	X(xrPathToString)                      \
+	X(xrCreateReferenceSpace)              \
+	X(xrCreateActionSpace)                 \
+	X(xrLocateSpace)                       \
+	X(xrLocateViews)                       \
+	X(xrCreateActionSet)                   \
+	X(xrCreateAction)                      \
+	X(xrSuggestInteractionProfileBindings) \
+	X(xrAttachSessionActionSets)           \
+	X(xrGetCurrentInteractionProfile)      \
+	X(xrSyncActions)                       \
+	X(xrGetActionStatePose)
+
+#ifdef XR_KHR_locate_spaces
+#define XRP_DISPATCH_LOCATE_SPACES_FUNCTIONS(X) X(xrLocateSpacesKHR)
+#else
+#define XRP_DISPATCH_LOCATE_SPACES_FUNCTIONS(X)
+#endif
+
+// Extension functions are null if the runtime doesn't provide them, so must be checked before being called
+#define XRP_DISPATCH_EXTENSION_FUNCTIONS(X) \
+	XRP_DISPATCH_LOCATE_SPACES_FUNCTIONS(X) \
+	X(xrCreateHandTrackerEXT)               \
+	X(xrDestroyHandTrackerEXT)              \
+	X(xrLocateHandJointsEXT)                \
+	X(xrCreateBodyTrackerFB)                \
+	X(xrDestroyBodyTrackerFB)               \
+	X(xrLocateBodyJointsFB)                 \
+	X(xrCreateFaceTrackerFB)                \
+	X(xrDestroyFaceTrackerFB)               \
+	X(xrGetFaceExpressionWeightsFB)
+
+#define XRP_DISPATCH_FUNCTIONS(X)  \
+	XRP_DISPATCH_CORE_FUNCTIONS(X) \
+	XRP_DISPATCH_EXTENSION_FUNCTIONS(X)
+
+enum XrpDispatchFunction {
+#define XRP_DISPATCH_ENUM(name) XRP_DISPATCH_##name,
+	XRP_DISPATCH_FUNCTIONS(XRP_DISPATCH_ENUM)
+#undef XRP_DISPATCH_ENUM
+	XRP_DISPATCH_FUNCTION_COUNT,
+};
+
+struct XrpDispatchTable {
+#define XRP_DISPATCH_MEMBER(name) PFN_##name name = nullptr;
+	XRP_DISPATCH_FUNCTIONS(XRP_DISPATCH_MEMBER)
+#undef XRP_DISPATCH_MEMBER
+};
+
+// Fills the table with instrumented wrappers around the runtime's functions. Only one instance is supported at a time.
+bool XrpLoadDispatchTable(XrInstance instance, XrpDispatchTable& out_table);
+
+#ifdef XR_KHR_locate_spaces
+// xrLocateSpaces is either core or an extension, so is loaded separately
+PFN_xrLocateSpacesKHR XrpInstrumentLocateSpaces(PFN_xrVoidFunction locate_spaces);
+#endif
+
+// Writes calls, p50, p99 and max latency of every function that has been called, as csv
+bool XrpWriteLatencySummary(const std::string& file_name);
@@ -0,0 +1,314 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "xrp.h"
+
+#if !defined(WIN32)
+#define vsnprintf_s vsnprintf
+#endif
+
+// large enough for XRP_CHECK_OR_RETURN failures, which have the full path of the file and the whole call expression
+static constexpr size_t xrp_log_message_size = 1024;
+static constexpr size_t xrp_log_queue_capacity = 1024;
+
+// identical messages logged from the same thread within this window are counted rather than written
+static constexpr std::chrono::seconds xrp_log_repeat_window(1);
+
+struct XrpLogRecord {
+	XrpLogLevel level;
+	char message[xrp_log_message_size];
+};
+
+// Bounded multi-producer, single-consumer ring buffer. Producers never block or allocate; when the ring is full the record is dropped.
+class XrpLogQueue {
+   public:
+	XrpLogQueue() {
+		for (size_t i = 0; i < xrp_log_queue_capacity; i++) {
+			cells_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// returns nullptr if the queue is full. The record must be committed with Commit once written.
+	XrpLogRecord* Reserve(size_t& out_position) {
+		size_t position = enqueue_position_.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell& cell = cells_[position % xrp_log_queue_capacity];
+			const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+			if (difference == 0) {
+				if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					out_position = position;
+					return &cell.record;
+				}
+			} else if (difference < 0) {
+				return nullptr;
+			} else {
+				position = enqueue_position_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void Commit(size_t position) { cells_[position % xrp_log_queue_capacity].sequence.store(position + 1, std::memory_order_release); }
+
+	// consumer thread only
+	bool Pop(XrpLogRecord& out_record) {
+		Cell& cell = cells_[dequeue_position_ % xrp_log_queue_capacity];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(dequeue_position_ + 1) < 0) {
+			return false;
+		}
+
+		out_record = cell.record;
+		cell.sequence.store(dequeue_position_ + xrp_log_queue_capacity, std::memory_order_release);
+		dequeue_position_++;
+
+		return true;
+	}
+
+	size_t GetEnqueuedCount() const { return enqueue_position_.load(std::memory_order_acquire); }
+
+   private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		XrpLogRecord record;
+	};
+
+	Cell cells_[xrp_log_queue_capacity];
+
+	alignas(64) std::atomic<size_t> enqueue_position_{0};
+	alignas(64) size_t dequeue_position_ = 0;
+};
+
+class XrpLogger {
+   public:
+	XrpLogger() : thread_([this] { Run(); }) {}
+
+	~XrpLogger() {
+		running_.store(false, std::memory_order_release);
+		Wake();
+		thread_.join();
+	}
+
+	void Push(XrpLogLevel level, const char* message) {
+		size_t position;
+		XrpLogRecord* record = queue_.Reserve(position);
+		if (!record) {
+			dropped_count_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		record->level = level;
+		strncpy(record->message, message, sizeof(record->message) - 1);
+		record->message[sizeof(record->message) - 1] = '\0';
+		queue_.Commit(position);
+
+		Wake();
+	}
+
+	void Flush() {
+		const size_t target = queue_.GetEnqueuedCount();
+
+		size_t written = written_count_.load(std::memory_order_acquire);
+		while (written < target) {
+			written_count_.wait(written, std::memory_order_acquire);
+			written = written_count_.load(std::memory_order_acquire);
+		}
+	}
+
+   private:
+	void Wake() {
+		wake_count_.fetch_add(1, std::memory_order_release);
+		wake_count_.notify_one();
+	}
+
+	static void Write(XrpLogLevel level, const char* message) {
+#ifdef XR_USE_PLATFORM_ANDROID
+		static const android_LogPriority priorities[] = {ANDROID_LOG_DEBUG, ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR};
+		__android_log_write(priorities[level], "danwillm", message);
+#else
+		fputs(message, stdout);
+		fputc('\n', stdout);
+#endif
+	}
+
+	void Run() {
+		XrpLogRecord record;
+
+		for (;;) {
+			const uint32_t wake_count = wake_count_.load(std::memory_order_acquire);
+
+			size_t written = 0;
+			while (queue_.Pop(record)) {
+				Write(record.level, record.message);
+				written++;
+			}
+
+			const size_t dropped_count = dropped_count_.exchange(0, std::memory_order_relaxed);
+			if (dropped_count > 0) {
+				char message[64];
+				snprintf(message, sizeof(message), "(%zu log messages dropped)", dropped_count);
+				Write(XRP_LOG_LEVEL_WARNING, message);
+			}
+
+			if (written > 0) {
+#ifndef XR_USE_PLATFORM_ANDROID
+				fflush(stdout);
+#endif
+				written_count_.fetch_add(written, std::memory_order_release);
+				written_count_.notify_all();
+				continue;
+			}
+
+			if (!running_.load(std::memory_order_acquire)) {
+				break;
+			}
+
+			wake_count_.wait(wake_count, std::memory_order_acquire);
+		}
+	}
+
+	XrpLogQueue queue_;
+
+	std::atomic<bool> running_{true};
+	std::atomic<uint32_t> wake_count_{0};
+	std::atomic<size_t> written_count_{0};
+	std::atomic<size_t> dropped_count_{0};
+
+	// last so it starts after everything it uses has been constructed
+	std::thread thread_;
+};
+
+static XrpLogger& XrpGetLogger() {
+	static XrpLogger logger;
+	return logger;
+}
+
+static std::atomic<int> xrp_log_level{XRP_LOG_LEVEL_INFO};
+
+struct XrpLogRepeatState;
+
+// every thread's repeat state, so XrpFlushLog can write the repeat counts that haven't been written yet
+struct XrpLogRepeatRegistry {
+	std::mutex mutex;
+	std::vector<XrpLogRepeatState*> states;
+};
+
+static XrpLogRepeatRegistry& XrpGetLogRepeatRegistry() {
+	static XrpLogRepeatRegistry registry;
+	return registry;
+}
+
+static void XrpLogFlushRepeats(XrpLogger& logger, XrpLogRepeatState& state);
+
+// per thread state for collapsing repeated messages
+struct XrpLogRepeatState {
+	// only contended while XrpFlushLog writes the pending repeat counts of every thread
+	std::mutex mutex;
+
+	char last_message[xrp_log_message_size] = {};
+	std::chrono::steady_clock::time_point last_time;
+	XrpLogLevel last_level = XRP_LOG_LEVEL_INFO;
+	uint32_t repeat_count = 0;
+
+	XrpLogRepeatState() {
+		// the logger and registry are constructed first, so they outlive every thread's state
+		XrpGetLogger();
+
+		XrpLogRepeatRegistry& registry = XrpGetLogRepeatRegistry();
+		std::scoped_lock lock(registry.mutex);
+		registry.states.push_back(this);
+	}
+
+	~XrpLogRepeatState() {
+		XrpLogRepeatRegistry& registry = XrpGetLogRepeatRegistry();
+		std::scoped_lock lock(registry.mutex, mutex);
+		std::erase(registry.states, this);
+
+		XrpLogFlushRepeats(XrpGetLogger(), *this);
+	}
+};
+
+// state's mutex must be held
+static void XrpLogFlushRepeats(XrpLogger& logger, XrpLogRepeatState& state) {
+	if (state.repeat_count == 0) {
+		return;
+	}
+
+	char message[xrp_log_message_size];
+	snprintf(message, sizeof(message), "(previous message repeated %u times)", state.repeat_count);
+	logger.Push(state.last_level, message);
+
+	state.repeat_count = 0;
+}
+
+static void XrpLogV(XrpLogLevel level, const char* format, va_list args) {
+	if (level < xrp_log_level.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	char message[xrp_log_message_size];
+	vsnprintf_s(message, sizeof(message), format, args);
+
+	XrpLogger& logger = XrpGetLogger();
+	static thread_local XrpLogRepeatState repeat_state;
+
+	std::scoped_lock lock(repeat_state.mutex);
+
+	const auto now = std::chrono::steady_clock::now();
+	if (strcmp(message, repeat_state.last_message) == 0 && now - repeat_state.last_time < xrp_log_repeat_window) {
+		repeat_state.repeat_count++;
+		return;
+	}
+
+	XrpLogFlushRepeats(logger, repeat_state);
+
+	strcpy(repeat_state.last_message, message);
+	repeat_state.last_time = now;
+	repeat_state.last_level = level;
+
+	logger.Push(level, message);
+}
+
+void XrpSetLogLevel(XrpLogLevel level) { xrp_log_level.store(level, std::memory_order_relaxed); }
+
+void XrpFlushLog() {
+	XrpLogger& logger = XrpGetLogger();
+
+	{
+		XrpLogRepeatRegistry& registry = XrpGetLogRepeatRegistry();
+		std::scoped_lock lock(registry.mutex);
+		for (XrpLogRepeatState* state : registry.states) {
+			std::scoped_lock state_lock(state->mutex);
+			XrpLogFlushRepeats(logger, *state);
+		}
+	}
+
+	logger.Flush();
+}
+
+void XrpLogMessage(XrpLogLevel level, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	XrpLogV(level, format, args);
+	va_end(args);
+}
+
+void XrpLog(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	XrpLogV(XRP_LOG_LEVEL_INFO, format, args);
+	va_end(args);
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "xrp_timing.h"
+
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "xrp.h"
+
+// initialized before main runs, so is as close to launch as we can get
+static const std::chrono::steady_clock::time_point xrp_launch_time = std::chrono::steady_clock::now();
+
+struct XrpTimingEntry {
+	const char* name;
+	double start_ms;
+	double duration_ms;
+};
+
+struct XrpTimingRecords {
+	std::mutex mutex;
+	std::vector<XrpTimingEntry> phases;
+	std::vector<XrpTimingEntry> milestones;
+};
+
+static XrpTimingRecords& XrpGetTimingRecords() {
+	static XrpTimingRecords records;
+	return records;
+}
+
+static double XrpMillisecondsSinceLaunch(const std::chrono::steady_clock::time_point time_point) {
+	return std::chrono::duration<double, std::milli>(time_point - xrp_launch_time).count();
+}
+
+XrpScopedPhase::XrpScopedPhase(const char* name) : name_(name), start_(std::chrono::steady_clock::now()) {}
+
+XrpScopedPhase::~XrpScopedPhase() { End(); }
+
+void XrpScopedPhase::End() {
+	if (ended_) {
+		return;
+	}
+
+	XrpRecordPhase(name_, start_, std::chrono::steady_clock::now());
+	ended_ = true;
+}
+
+void XrpRecordPhase(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end) {
+	const double start_ms = XrpMillisecondsSinceLaunch(start);
+	const double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	XrpLogMessage(XRP_LOG_LEVEL_DEBUG, "%s took %.3f ms", name, duration_ms);
+
+	XrpTimingRecords& records = XrpGetTimingRecords();
+	std::scoped_lock lock(records.mutex);
+	records.phases.push_back({.name = name, .start_ms = start_ms, .duration_ms = duration_ms});
+}
+
+void XrpRecordMilestone(const char* name) {
+	const double time_ms = XrpMillisecondsSinceLaunch(std::chrono::steady_clock::now());
+
+	XrpLogMessage(XRP_LOG_LEVEL_DEBUG, "%s at %.3f ms", name, time_ms);
+
+	XrpTimingRecords& records = XrpGetTimingRecords();
+	std::scoped_lock lock(records.mutex);
+	records.milestones.push_back({.name = name, .start_ms = time_ms, .duration_ms = 0.0});
+}
+
+static void XrpWriteJsonString(FILE* file, const char* string) {
+	fputc('"', file);
+	for (const char* c = string; *c; c++) {
+		switch (*c) {
+			case '"':
+				fputs("\\\"", file);
+				break;
+			case '\\':
+				fputs("\\\\", file);
+				break;
+			default:
+				if (static_cast<unsigned char>(*c) < 0x20) {
+					fprintf(file, "\\u%04x", *c);
+				} else {
+					fputc(*c, file);
+				}
+				break;
+		}
+	}
+	fputc('"', file);
+}
+
+bool XrpWriteTimingReport(const std::string& file_name, const std::string& runtime_name) {
+	FILE* file = fopen(file_name.c_str(), "w");
+	if (!file) {
+		XrpLog("failed to open timing report: %s", file_name.c_str());
+		return false;
+	}
+
+	XrpTimingRecords& records = XrpGetTimingRecords();
+	std::scoped_lock lock(records.mutex);
+
+	fputs("{\n\t\"runtime\": ", file);
+	XrpWriteJsonString(file, runtime_name.c_str());
+
+	fputs(",\n\t\"phases\": [", file);
+	for (size_t i = 0; i < records.phases.size(); i++) {
+		const XrpTimingEntry& phase = records.phases[i];
+
+		fputs(i == 0 ? "\n\t\t{\"name\": " : ",\n\t\t{\"name\": ", file);
+		XrpWriteJsonString(file, phase.name);
+		fprintf(file, ", \"start_ms\": %.3f, \"duration_ms\": %.3f}", phase.start_ms, phase.duration_ms);
+	}
+
+	fputs("\n\t],\n\t\"milestones\": [", file);
+	for (size_t i = 0; i < records.milestones.size(); i++) {
+		const XrpTimingEntry& milestone = records.milestones[i];
+
+		fputs(i == 0 ? "\n\t\t{\"name\": " : ",\n\t\t{\"name\": ", file);
+		XrpWriteJsonString(file, milestone.name);
+		fprintf(file, ", \"time_ms\": %.3f}", milestone.start_ms);
+	}
+	fputs("\n\t]\n}\n", file);
+
+	const bool success = fclose(file) == 0;
+	if (!success) {
+		XrpLog("failed to write timing report: %s", file_name.c_str());
+	}
+
+	return success;
+}
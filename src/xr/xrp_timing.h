@@ -0,0 +1,38 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// Times are measured from when the process started
+
+// Records how long a phase of startup (or shutdown) took, from construction until End or destruction
+class XrpScopedPhase {
+   public:
+	explicit XrpScopedPhase(const char* name);
+	~XrpScopedPhase();
+
+	XrpScopedPhase(const XrpScopedPhase&) = delete;
+	XrpScopedPhase& operator=(const XrpScopedPhase&) = delete;
+
+	void End();
+
+   private:
+	const char* name_;
+	std::chrono::steady_clock::time_point start_;
+	bool ended_ = false;
+};
+
+// For phases that don't fit a scope, e.g. waiting for a session state
+void XrpRecordPhase(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+// A point in time worth reporting, e.g. when the output was written
+void XrpRecordMilestone(const char* name);
+
+// Writes every phase and milestone recorded so far as json
+bool XrpWriteTimingReport(const std::string& file_name, const std::string& runtime_name);
@@ -0,0 +1,141 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#include "xrp_trace.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "xrp.h"
+
+struct XrpTraceEvent {
+	std::string_view name;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point end;
+};
+
+struct XrpTraceBuffer {
+	uint32_t thread_id;
+	std::unique_ptr<XrpTraceEvent[]> events;
+	size_t capacity;
+
+	// only written by the owning thread
+	std::atomic<size_t> count{0};
+	std::atomic<size_t> dropped_count{0};
+};
+
+struct XrpTraceState {
+	std::mutex mutex;
+	size_t events_per_thread = 0;
+	std::chrono::steady_clock::time_point start_time;
+
+	// buffers outlive their threads, so events from threads that have exited are still written
+	std::vector<std::unique_ptr<XrpTraceBuffer>> buffers;
+};
+
+static XrpTraceState& XrpGetTraceState() {
+	static XrpTraceState state;
+	return state;
+}
+
+static XrpTraceBuffer* XrpGetThreadTraceBuffer() {
+	static thread_local XrpTraceBuffer* thread_buffer = nullptr;
+	if (thread_buffer) {
+		return thread_buffer;
+	}
+
+	XrpTraceState& state = XrpGetTraceState();
+	std::scoped_lock lock(state.mutex);
+
+	auto buffer = std::make_unique<XrpTraceBuffer>();
+	buffer->thread_id = static_cast<uint32_t>(state.buffers.size());
+	buffer->events = std::make_unique<XrpTraceEvent[]>(state.events_per_thread);
+	buffer->capacity = state.events_per_thread;
+
+	thread_buffer = buffer.get();
+	state.buffers.push_back(std::move(buffer));
+
+	return thread_buffer;
+}
+
+void XrpEnableTracing(size_t events_per_thread) {
+	{
+		XrpTraceState& state = XrpGetTraceState();
+		std::scoped_lock lock(state.mutex);
+
+		state.events_per_thread = events_per_thread;
+		state.start_time = std::chrono::steady_clock::now();
+	}
+
+	// allocate the calling thread's buffer up front, rather than during its first call
+	XrpGetThreadTraceBuffer();
+
+	xrp_tracing_enabled = true;
+}
+
+void XrpRecordTraceEvent(std::string_view name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+	XrpTraceBuffer* buffer = XrpGetThreadTraceBuffer();
+
+	const size_t count = buffer->count.load(std::memory_order_relaxed);
+	if (count >= buffer->capacity) {
+		buffer->dropped_count.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer->events[count] = {.name = name, .start = start, .end = end};
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+static double XrpTraceMicroseconds(const std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+bool XrpWriteTrace(const std::string& file_name) {
+	if (!XrpIsTracingEnabled()) {
+		return true;
+	}
+
+	FILE* file = fopen(file_name.c_str(), "w");
+	if (!file) {
+		XrpLog("failed to open trace file: %s", file_name.c_str());
+		return false;
+	}
+
+	XrpTraceState& state = XrpGetTraceState();
+	std::scoped_lock lock(state.mutex);
+
+	fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n", file);
+
+	bool first_event = true;
+	for (const auto& buffer : state.buffers) {
+		const size_t count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++) {
+			const XrpTraceEvent& event = buffer->events[i];
+
+			fprintf(file, "%s{\"name\": \"%.*s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", first_event ? "" : ",\n",
+					static_cast<int>(event.name.size()), event.name.data(), buffer->thread_id, XrpTraceMicroseconds(event.start - state.start_time),
+					XrpTraceMicroseconds(event.end - event.start));
+			first_event = false;
+		}
+
+		const size_t dropped_count = buffer->dropped_count.load(std::memory_order_relaxed);
+		if (dropped_count > 0) {
+			XrpLog("trace buffer for thread %u was full, %zu events were dropped", buffer->thread_id, dropped_count);
+		}
+	}
+
+	fputs("\n]}\n", file);
+
+	const bool success = fclose(file) == 0;
+	if (!success) {
+		XrpLog("failed to write trace file: %s", file_name.c_str());
+	}
+
+	return success;
+}
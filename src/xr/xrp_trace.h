@@ -0,0 +1,62 @@
+// Copyright (c) 2023 Valve Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+// Initial Author: Daniel Willmott <danw@valvesoftware.com>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Optional tracing of OpenXR calls and other scopes, exported in the Chrome trace event format (chrome://tracing, Perfetto).
+// Each thread records into its own buffer, allocated once with a fixed capacity. Events past the capacity are dropped.
+
+inline bool xrp_tracing_enabled = false;
+
+// Must be called before any other thread records events
+void XrpEnableTracing(size_t events_per_thread);
+
+static inline bool XrpIsTracingEnabled() { return xrp_tracing_enabled; }
+
+void XrpRecordTraceEvent(std::string_view name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+// Other threads must have stopped recording before this is called
+bool XrpWriteTrace(const std::string& file_name);
+
+class XrpTraceScope {
+   public:
+	explicit XrpTraceScope(std::string_view name) : name_(name) {
+		if (XrpIsTracingEnabled()) {
+			start_ = std::chrono::steady_clock::now();
+		}
+	}
+
+	~XrpTraceScope() {
+		if (XrpIsTracingEnabled()) {
+			XrpRecordTraceEvent(name_, start_, std::chrono::steady_clock::now());
+		}
+	}
+
+	XrpTraceScope(const XrpTraceScope&) = delete;
+	XrpTraceScope& operator=(const XrpTraceScope&) = delete;
+
+   private:
+	std::string_view name_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+// "context.dispatch.xrWaitFrame(session, ...)" -> "xrWaitFrame". Empty if the expression isn't a call, e.g. a result that was
+// already returned
+constexpr std::string_view XrpGetTraceCallName(std::string_view expression) {
+	const size_t call_start = expression.find('(');
+	if (call_start == std::string_view::npos) {
+		return {};
+	}
+
+	const std::string_view function = expression.substr(0, call_start);
+	const size_t member_start = function.rfind('.');
+	return member_start == std::string_view::npos ? function : function.substr(member_start + 1);
+}